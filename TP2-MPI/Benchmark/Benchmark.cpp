@@ -0,0 +1,343 @@
+#include "../MPIUtils.h"
+#include "../MPITrace.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Benchmark of the MPI solvers on a problem of configurable size.
+//
+// Usage: Benchmark <jacobi|matmul> <size> <iterations> [hierarchical|rma] [shared] [trace]
+//
+// The manager prints one JSON object describing the run. Jacobi performs <iterations> sweeps
+// over a <size> x <size> grid (one job per interior row), matmul performs <iterations>
+// multiplications of two <size> x <size> matrices (B is broadcast, one job per row of A).
+// Jobs are scheduled by runHierarchicalJobFarm (default) or runSelfScheduledJobFarm (rma).
+// With shared, matmul keeps a single copy of B per node in a node shared array: B is only
+// broadcast to the first process of each node, and the other processes read its rows in place.
+// With trace, MPI calls and the compute phase of each job are traced to <jacobi|matmul>.trace.json
+// and <jacobi|matmul>.csv (see MPITrace.h).
+//
+// The manager checks the result against a serial computation ("valid" in the JSON object): Jacobi
+// sweeps are recomputed, and matmul rows are checked through their weighted sums (C w = A (B w)).
+
+// Job farm used to run the solvers
+static void (*g_RunJobFarm)(JobFarm const &, uint32_t) = runHierarchicalJobFarm;
+
+// Measures of one benchmark run
+struct BenchResult
+{
+    double seconds;
+    double flops;
+    double bytesMoved;
+
+    // Result matches the serial computation (only meaningful on the manager)
+    bool isValid;
+};
+
+// Largest difference allowed between a result and its serial computation, relative to its magnitude
+double const TOLERANCE = 1e-9;
+
+// Compute the interior of row 1 of i_Rows (3 rows of i_Size values) with one Jacobi sweep
+static void computeJacobiRow(double const * i_Rows, uint32_t i_Size, double * o_Result)
+{
+    for (auto i = 1U; i < i_Size - 1; ++i)
+    {
+        o_Result[i - 1] = (i_Rows[i] +
+            i_Rows[i_Size + i + 1] +
+            i_Rows[2 * i_Size + i] +
+            i_Rows[i_Size + i - 1]) / 4.0;
+    }
+}
+
+// Check if i_Value matches i_Expected within TOLERANCE
+static bool isClose(double i_Value, double i_Expected)
+{
+    return std::fabs(i_Value - i_Expected) <= TOLERANCE * std::max(std::fabs(i_Expected), 1.0);
+}
+
+static BenchResult benchJacobi(uint32_t i_Size, uint32_t i_NumIter, uint32_t i_NumProc)
+{
+    int processID;
+    MPI_Comm_rank(MPI_COMM_WORLD, &processID);
+
+    // Create grid with borders at -1 and each row filled with its index
+    std::vector<double> grid(i_Size * i_Size);
+    for (auto y = 0U; y < i_Size; ++y)
+    {
+        for (auto x = 0U; x < i_Size; ++x)
+        {
+            auto isBorder = y == 0 || y == i_Size - 1 || x == 0 || x == i_Size - 1;
+            grid[y * i_Size + x] = isBorder ? -1.0 : y;
+        }
+    }
+    auto newGrid = grid;
+
+    // Initial grid of the serial sweeps checking the result
+    auto initialGrid = processID == MANAGER_ID ? grid : std::vector<double>();
+
+    JobFarm farm;
+    farm.numJobs    = i_Size - 2;
+    farm.inputSize  = 3 * i_Size;
+    farm.resultSize = i_Size - 2;
+    farm.fillInput = [&](uint32_t i_JobID, double * o_Input)
+    {
+        std::copy(&grid[i_JobID * i_Size], &grid[(i_JobID + 3) * i_Size], o_Input);
+    };
+    farm.compute = [=](double const * i_Input, double * o_Result)
+    {
+        ScopedTimer timer("compute");
+        computeJacobiRow(i_Input, i_Size, o_Result);
+    };
+    farm.storeResult = [&](uint32_t i_JobID, double const * i_Result)
+    {
+        std::copy(i_Result, i_Result + i_Size - 2, &newGrid[(i_JobID + 1) * i_Size + 1]);
+    };
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    auto start = MPI_Wtime();
+    for (auto iter = 0U; iter < i_NumIter; ++iter)
+    {
+        g_RunJobFarm(farm, 16);
+        grid.swap(newGrid);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    // 3 additions and 1 division per interior cell, rows and results exchanged once per job
+    BenchResult result;
+    result.seconds    = MPI_Wtime() - start;
+    result.flops      = 4.0 * (i_Size - 2) * (i_Size - 2) * i_NumIter;
+    result.bytesMoved = i_NumProc == 1 ? 0.0 :
+        sizeof(double) * (i_Size - 2.0) * (farm.inputSize + farm.resultSize + 2) * i_NumIter;
+
+    // Run the same sweeps serially on the manager, which holds the result
+    result.isValid = processID == MANAGER_ID;
+    if (result.isValid)
+    {
+        auto & reference = initialGrid;
+        auto newReference = reference;
+        for (auto iter = 0U; iter < i_NumIter; ++iter)
+        {
+            for (auto y = 1U; y < i_Size - 1; ++y)
+            {
+                computeJacobiRow(&reference[(y - 1) * i_Size], i_Size, &newReference[y * i_Size + 1]);
+            }
+            reference.swap(newReference);
+        }
+        for (auto i = 0U; i < grid.size() && result.isValid; ++i)
+        {
+            result.isValid = isClose(grid[i], reference[i]);
+        }
+    }
+    return result;
+}
+
+static BenchResult benchMatMul(uint32_t i_Size, uint32_t i_NumIter, uint32_t i_NumProc, bool i_IsShared)
+{
+    int processID;
+    MPI_Comm_rank(MPI_COMM_WORLD, &processID);
+
+    // Fill with arbitrary values (B is stored transposed)
+    auto numElem = i_Size * i_Size;
+    std::vector<double> matrixA (numElem);
+    std::vector<double> matrixBt(numElem);
+    std::vector<double> results (numElem);
+    for (auto i = 0U; i < numElem; ++i)
+    {
+        matrixA [i] =   static_cast<double>(i % 17);
+        matrixBt[i] = - static_cast<double>(i % 13) + 6.0;
+    }
+
+    // Copy of B read by the jobs: our own, or the one of the node
+    double * bt = matrixBt.data();
+    NodeSharedArray sharedBt;
+    MPI_Comm firstOfNodesComm = MPI_COMM_NULL;
+    auto numCopies = i_NumProc;
+    if (i_IsShared)
+    {
+        sharedBt = createNodeSharedCopy(numElem);
+        bt = sharedBt.segments[0];
+
+        // Group the first process of every node (the manager is the first one of its node)
+        MPI_Comm_split(MPI_COMM_WORLD, sharedBt.nodeID == 0 ? 0 : MPI_UNDEFINED, processID, &firstOfNodesComm);
+        if (firstOfNodesComm != MPI_COMM_NULL)
+        {
+            int numNodes;
+            MPI_Comm_size(firstOfNodesComm, &numNodes);
+            numCopies = numNodes;
+        }
+        if (processID == MANAGER_ID)
+        {
+            std::copy(matrixBt.begin(), matrixBt.end(), bt);
+        }
+    }
+
+    JobFarm farm;
+    farm.numJobs    = i_Size;
+    farm.inputSize  = i_Size;
+    farm.resultSize = i_Size;
+    farm.fillInput = [&](uint32_t i_JobID, double * o_Input)
+    {
+        std::copy(&matrixA[i_JobID * i_Size], &matrixA[(i_JobID + 1) * i_Size], o_Input);
+    };
+    farm.compute = [&](double const * i_Input, double * o_Result)
+    {
+        ScopedTimer timer("compute");
+        for (auto col = 0U; col < i_Size; ++col)
+        {
+            auto dot = 0.0;
+            for (auto i = 0U; i < i_Size; ++i)
+            {
+                dot += i_Input[i] * bt[col * i_Size + i];
+            }
+            o_Result[col] = dot;
+        }
+    };
+    farm.storeResult = [&](uint32_t i_JobID, double const * i_Result)
+    {
+        std::copy(i_Result, i_Result + i_Size, &results[i_JobID * i_Size]);
+    };
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    auto start = MPI_Wtime();
+    for (auto iter = 0U; iter < i_NumIter; ++iter)
+    {
+        if (i_IsShared)
+        {
+            // The first process of each node receives B for the whole node, which waits for it
+            if (firstOfNodesComm != MPI_COMM_NULL)
+            {
+                MPI_Bcast(bt, numElem, MPI_DOUBLE, MANAGER_ID, firstOfNodesComm);
+            }
+            syncNodeSharedArray(sharedBt);
+        }
+        else
+        {
+            MPI_Bcast(bt, numElem, MPI_DOUBLE, MANAGER_ID, MPI_COMM_WORLD);
+        }
+        g_RunJobFarm(farm, 16);
+
+        // No process of the node may still read B when the next broadcast overwrites it
+        if (i_IsShared)
+        {
+            syncNodeSharedArray(sharedBt);
+        }
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    // One multiplication and one addition per term of each dot product
+    BenchResult result;
+    result.seconds    = MPI_Wtime() - start;
+    result.flops      = 2.0 * i_Size * i_Size * i_Size * i_NumIter;
+    result.bytesMoved = i_NumProc == 1 ? 0.0 : sizeof(double) * i_NumIter *
+        ((numCopies - 1.0) * numElem + i_Size * (farm.inputSize + farm.resultSize + 2.0));
+
+    // Check every row of C = A B against A (B w) for arbitrary weights w on the manager, which
+    // holds the result, in O(size^2)
+    result.isValid = processID == MANAGER_ID;
+    if (result.isValid)
+    {
+        std::vector<double> weights(i_Size);
+        std::vector<double> weightedB(i_Size, 0.0);
+        for (auto col = 0U; col < i_Size; ++col)
+        {
+            weights[col] = static_cast<double>(col % 7) + 1.0;
+            for (auto i = 0U; i < i_Size; ++i)
+            {
+                weightedB[i] += matrixBt[col * i_Size + i] * weights[col];
+            }
+        }
+        for (auto row = 0U; row < i_Size && result.isValid; ++row)
+        {
+            auto value = 0.0;
+            auto expected = 0.0;
+            for (auto i = 0U; i < i_Size; ++i)
+            {
+                value    += results[row * i_Size + i] * weights[i];
+                expected += matrixA[row * i_Size + i] * weightedB[i];
+            }
+            result.isValid = isClose(value, expected);
+        }
+    }
+
+    if (i_IsShared)
+    {
+        if (firstOfNodesComm != MPI_COMM_NULL)
+        {
+            MPI_Comm_free(&firstOfNodesComm);
+        }
+        freeNodeSharedArray(sharedBt);
+    }
+    return result;
+}
+
+int main(int argc, char ** argv)
+{
+    MPI_Init(&argc, &argv);
+
+    int processID;
+    MPI_Comm_rank(MPI_COMM_WORLD, &processID);
+    int numProcesses;
+    MPI_Comm_size(MPI_COMM_WORLD, &numProcesses);
+
+    auto isJacobi = argc > 1 && strcmp(argv[1], "jacobi") == 0;
+    auto isMatMul = argc > 1 && strcmp(argv[1], "matmul") == 0;
+    auto isRMA    = false;
+    auto isShared = false;
+    auto isTraced = false;
+    auto isUsageValid = argc >= 4 && (isJacobi || isMatMul);
+    for (auto i = 4; i < argc && isUsageValid; ++i)
+    {
+        if (strcmp(argv[i], "rma") == 0)
+        {
+            isRMA = true;
+        }
+        else if (strcmp(argv[i], "shared") == 0)
+        {
+            isShared = true;
+        }
+        else if (strcmp(argv[i], "trace") == 0)
+        {
+            isTraced = true;
+        }
+        else if (strcmp(argv[i], "hierarchical") != 0)
+        {
+            isUsageValid = false;
+        }
+    }
+    if (!isUsageValid)
+    {
+        if (processID == MANAGER_ID)
+        {
+            fprintf(stderr, "Usage: %s <jacobi|matmul> <size> <iterations> [hierarchical|rma] [shared] [trace]\n", argv[0]);
+        }
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+
+    if (isTraced)
+    {
+        enableTracing(argv[1]);
+    }
+    if (isRMA)
+    {
+        g_RunJobFarm = runSelfScheduledJobFarm;
+    }
+
+    auto size    = std::max(static_cast<uint32_t>(atoi(argv[2])), 3U);
+    auto numIter = std::max(static_cast<uint32_t>(atoi(argv[3])), 1U);
+    auto result  = isJacobi ? benchJacobi(size, numIter, numProcesses) :
+                              benchMatMul(size, numIter, numProcesses, isShared);
+
+    if (processID == MANAGER_ID)
+    {
+        printf("{\"solver\":\"%s\",\"scheduler\":\"%s\",\"shared\":%s,\"processes\":%d,\"size\":%u,\"iterations\":%u,"
+               "\"seconds\":%.9g,\"seconds_per_iteration\":%.9g,\"gflops\":%.9g,\"bytes_moved\":%.0f,\"valid\":%s}\n",
+               argv[1], isRMA ? "rma" : "hierarchical", isShared ? "true" : "false", numProcesses, size, numIter, result.seconds, result.seconds / numIter,
+               result.flops / result.seconds * 1e-9, result.bytesMoved, result.isValid ? "true" : "false");
+    }
+
+    MPI_Finalize();
+}
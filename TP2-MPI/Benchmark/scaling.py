@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+"""Strong and weak scaling sweeps of the MPI solvers.
+
+Runs the Benchmark executable with mpiexec for every process count from 1 to --max-procs:
+  - strong scaling: the same problem sizes (--sizes) for every process count
+  - weak scaling: the work per process stays constant, so the size grows with the process count
+    (sqrt for Jacobi, which is O(n^2), cube root for matmul, which is O(n^3))
+
+Every run is written to --output as JSON, with the parallel efficiency relative to the
+single-process run of the same sweep. The sweep fails as soon as a run reports a result that does
+not match the serial computation ("valid": false).
+
+Example: python scaling.py --exe ./Benchmark --max-procs 8 --output scaling.json
+"""
+
+import argparse
+import json
+import subprocess
+import sys
+
+# Exponent linking the problem size to the amount of work of each solver
+WORK_EXPONENT = {"jacobi": 2, "matmul": 3}
+
+
+def run(args, solver, procs, size):
+    command = [args.mpiexec, "-n", str(procs)] + args.mpiexec_args + \
+              [args.exe, solver, str(size), str(args.iterations[solver]), args.scheduler] + \
+              (["shared"] if args.shared else [])
+    output = subprocess.run(command, check=True, stdout=subprocess.PIPE, universal_newlines=True).stdout
+    lines = [line for line in output.splitlines() if line.startswith("{")]
+    result = json.loads(lines[-1])
+    if not result.get("valid", False):
+        sys.exit("Invalid result: " + " ".join(command))
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--exe", required=True, help="path to the Benchmark executable")
+    parser.add_argument("--mpiexec", default="mpiexec")
+    parser.add_argument("--mpiexec-args", default="", help="extra arguments given to mpiexec")
+    parser.add_argument("--max-procs", type=int, required=True)
+    parser.add_argument("--scheduler", default="hierarchical", choices=["hierarchical", "rma"])
+    parser.add_argument("--shared", action="store_true", help="keep one copy of B per node for matmul")
+    parser.add_argument("--solvers", nargs="+", default=["jacobi", "matmul"], choices=sorted(WORK_EXPONENT))
+    parser.add_argument("--sizes", nargs="+", type=int, default=[512, 2048], help="strong scaling sizes")
+    parser.add_argument("--weak-size", type=int, default=512, help="weak scaling size for one process")
+    parser.add_argument("--jacobi-iterations", type=int, default=20)
+    parser.add_argument("--matmul-iterations", type=int, default=2)
+    parser.add_argument("--output", default="scaling.json")
+    args = parser.parse_args()
+    args.mpiexec_args = args.mpiexec_args.split()
+    args.iterations = {"jacobi": args.jacobi_iterations, "matmul": args.matmul_iterations}
+
+    runs = []
+    for solver in args.solvers:
+        # Strong scaling: efficiency = T1 / (P * TP)
+        for size in args.sizes:
+            base = None
+            for procs in range(1, args.max_procs + 1):
+                result = run(args, solver, procs, size)
+                base = base or result["seconds_per_iteration"]
+                result["mode"] = "strong"
+                result["efficiency"] = base / (procs * result["seconds_per_iteration"])
+                runs.append(result)
+                print(json.dumps(result), file=sys.stderr)
+
+        # Weak scaling: efficiency = T1 / TP
+        base = None
+        for procs in range(1, args.max_procs + 1):
+            size = int(round(args.weak_size * procs ** (1.0 / WORK_EXPONENT[solver])))
+            result = run(args, solver, procs, size)
+            base = base or result["seconds_per_iteration"]
+            result["mode"] = "weak"
+            result["efficiency"] = base / result["seconds_per_iteration"]
+            runs.append(result)
+            print(json.dumps(result), file=sys.stderr)
+
+    with open(args.output, "w") as output:
+        json.dump({"runs": runs}, output, indent=2)
+
+
+if __name__ == "__main__":
+    main()
@@ -1,9 +1,11 @@
 #include "MPIUtils.h"
+#include "MPITrace.h"
 #include <algorithm>
 #include <iomanip>
 #include <iostream>
 #include <mpi.h>
 #include <cmath>
+#include <cstring>
 
 uint32_t    const NUM_ROWS = 4;
 MPI_Request const ON_VACATION = std::numeric_limits<MPI_Request>().max();
@@ -146,7 +148,10 @@ void runManager(uint32_t, uint32_t i_NumProc)
 		std::cout << "Results received. About to compute norm difference... " << std::endl;
 		
 		// Compute norm difference between matrices
-		difference = sqrt(computeSquaredNormDifference(oldMatrix, matrix));
+		{
+			ScopedTimer timer("norm");
+			difference = sqrt(computeSquaredNormDifference(oldMatrix, matrix));
+		}
 		
 		// Print information
 		std::cout << "Iteration #" << iter << std::endl;
@@ -180,14 +185,17 @@ void runWorker(uint32_t, uint32_t)
 			return;
 		}
 
-		// Computation
+		// Computation (timed apart from the send below)
 		double result[NUM_ROWS - 2];
-		for (auto i = 1U; i < NUM_ROWS - 1; ++i)
 		{
-			result[i - 1] = (input[i] +
-				input[NUM_ROWS + i + 1] +
-				input[2 * NUM_ROWS + i] +
-				input[NUM_ROWS + i - 1]) / 4.0;
+			ScopedTimer timer("compute");
+			for (auto i = 1U; i < NUM_ROWS - 1; ++i)
+			{
+				result[i - 1] = (input[i] +
+					input[NUM_ROWS + i + 1] +
+					input[2 * NUM_ROWS + i] +
+					input[NUM_ROWS + i - 1]) / 4.0;
+			}
 		}
 
 		// Send result back
@@ -199,5 +207,11 @@ void runWorker(uint32_t, uint32_t)
 
 int main(int argc, char ** argv)
 {
+    // Write Jacobi.trace.json and Jacobi.csv at the end of the run
+    if (argc > 1 && strcmp(argv[1], "--trace") == 0)
+    {
+        enableTracing("Jacobi");
+    }
+
     runManagerWorkerAlgorithm(argc, argv, runManager, runWorker);
 }
\ No newline at end of file
@@ -0,0 +1,372 @@
+#include "MPITrace.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <mpi.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Calling convention of the MPI functions (only defined by MS-MPI)
+#ifndef MPIAPI
+#define MPIAPI
+#endif
+
+// One timed phase
+struct TraceEvent
+{
+    char const * phase;
+    double       start;
+    double       end;
+};
+
+// Communication with one peer
+struct PeerStats
+{
+    // Messages sent, and time spent in blocking sends
+    uint64_t numMessages;
+    uint64_t numBytes;
+    double   time;
+
+    // Messages received (posted receives for MPI_Irecv)
+    uint64_t numReceived;
+    uint64_t numBytesReceived;
+};
+
+// Phase of the calls waiting for messages. Polls (MPI_Test, MPI_Iprobe) starting less than
+// POLL_MERGE_GAP seconds after the previous wait extend it instead of adding a record, so a
+// polling loop shows up as one wait instead of filling the ring buffer.
+static char const * const WAIT_PHASE     = "wait";
+static double const       POLL_MERGE_GAP = 1e-4;
+
+static bool                    g_IsEnabled = false;
+static std::string             g_OutputPrefix;
+static double                  g_Origin;
+static std::vector<TraceEvent> g_Events;
+static std::atomic<uint64_t>   g_NumEvents(0);
+static std::vector<PeerStats>  g_Peers;
+
+static void recordEvent(char const * i_Phase, double i_Start, double i_End)
+{
+    auto index = g_NumEvents.fetch_add(1, std::memory_order_relaxed) % g_Events.size();
+    g_Events[index].phase = i_Phase;
+    g_Events[index].start = i_Start;
+    g_Events[index].end   = i_End;
+}
+
+// Convert a rank of i_Comm to a rank of MPI_COMM_WORLD
+static int toWorldRank(MPI_Comm i_Comm, int i_Rank)
+{
+    if (i_Comm == MPI_COMM_WORLD || i_Rank < 0)
+    {
+        return i_Rank;
+    }
+    MPI_Group group;
+    MPI_Group worldGroup;
+    PMPI_Comm_group(i_Comm, &group);
+    PMPI_Comm_group(MPI_COMM_WORLD, &worldGroup);
+    int worldRank;
+    PMPI_Group_translate_ranks(group, 1, &i_Rank, worldGroup, &worldRank);
+    PMPI_Group_free(&group);
+    PMPI_Group_free(&worldGroup);
+    return worldRank;
+}
+
+static void recordPoll(double i_Start, double i_End)
+{
+    auto numEvents = g_NumEvents.load(std::memory_order_relaxed);
+    if (numEvents > 0)
+    {
+        auto & last = g_Events[(numEvents - 1) % g_Events.size()];
+        if (last.phase == WAIT_PHASE && i_Start - last.end < POLL_MERGE_GAP)
+        {
+            last.end = i_End;
+            return;
+        }
+    }
+    recordEvent(WAIT_PHASE, i_Start, i_End);
+}
+
+static void recordSend(int i_Count, MPI_Datatype i_Type, int i_Dest, MPI_Comm i_Comm, double i_Time)
+{
+    auto peer = toWorldRank(i_Comm, i_Dest);
+    if (peer < 0 || peer >= static_cast<int>(g_Peers.size()))
+    {
+        return;
+    }
+    int typeSize;
+    PMPI_Type_size(i_Type, &typeSize);
+    ++g_Peers[peer].numMessages;
+    g_Peers[peer].numBytes += static_cast<uint64_t>(i_Count) * typeSize;
+    g_Peers[peer].time     += i_Time;
+}
+
+static void recordReceive(int i_Count, MPI_Datatype i_Type, int i_Source, MPI_Comm i_Comm)
+{
+    auto peer = toWorldRank(i_Comm, i_Source);
+    if (peer < 0 || peer >= static_cast<int>(g_Peers.size()))
+    {
+        return;
+    }
+    int typeSize;
+    PMPI_Type_size(i_Type, &typeSize);
+    ++g_Peers[peer].numReceived;
+    g_Peers[peer].numBytesReceived += static_cast<uint64_t>(i_Count) * typeSize;
+}
+
+// Gather text of every process on the manager (in rank order)
+static std::string gatherText(std::string const & i_Text, int i_ProcessID, int i_NumProcesses)
+{
+    int length = static_cast<int>(i_Text.size());
+    std::vector<int> lengths(i_NumProcesses);
+    PMPI_Gather(&length, 1, MPI_INT, lengths.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    std::vector<int> offsets(i_NumProcesses, 0);
+    for (auto i = 1; i < i_NumProcesses; ++i)
+    {
+        offsets[i] = offsets[i - 1] + lengths[i - 1];
+    }
+    std::string all(i_ProcessID == 0 ? offsets.back() + lengths.back() : 0, ' ');
+    PMPI_Gatherv(const_cast<char *>(i_Text.data()), length, MPI_CHAR, &all[0], lengths.data(),
+                 offsets.data(), MPI_CHAR, 0, MPI_COMM_WORLD);
+    return all;
+}
+
+// Merge the records of every process and write the trace and summary files
+static void writeTrace()
+{
+    int processID;
+    PMPI_Comm_rank(MPI_COMM_WORLD, &processID);
+    int numProcesses;
+    PMPI_Comm_size(MPI_COMM_WORLD, &numProcesses);
+
+    uint64_t numEvents = g_NumEvents.load();
+    auto numKept = std::min<uint64_t>(numEvents, g_Events.size());
+
+    // Chrome trace events of this process (timestamps in microseconds)
+    std::ostringstream json;
+    json << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << processID
+         << ",\"args\":{\"name\":\"Rank " << processID << "\"}},\n";
+
+    // Per phase statistics: count, total and maximum duration
+    std::map<std::string, std::vector<double>> phases;
+    for (uint64_t i = numEvents - numKept; i < numEvents; ++i)
+    {
+        auto const & event = g_Events[i % g_Events.size()];
+        auto duration = (event.end - event.start) * 1e6;
+        json << "{\"name\":\"" << event.phase << "\",\"ph\":\"X\",\"pid\":" << processID
+             << ",\"tid\":0,\"ts\":" << (event.start - g_Origin) * 1e6 << ",\"dur\":" << duration << "},\n";
+
+        auto & stats = phases[event.phase];
+        stats.resize(3, 0.0);
+        stats[0] += 1;
+        stats[1] += duration;
+        stats[2]  = std::max(stats[2], duration);
+    }
+
+    std::ostringstream csv;
+    for (auto const & phase : phases)
+    {
+        csv << processID << ",phase," << phase.first << "," << phase.second[0] << ","
+            << phase.second[1] << "," << phase.second[2] << ",0\n";
+    }
+    for (auto i = 0U; i < g_Peers.size(); ++i)
+    {
+        if (g_Peers[i].numMessages > 0)
+        {
+            csv << processID << ",send," << i << "," << g_Peers[i].numMessages << ","
+                << g_Peers[i].time * 1e6 << ",0," << g_Peers[i].numBytes << "\n";
+        }
+        if (g_Peers[i].numReceived > 0)
+        {
+            csv << processID << ",recv," << i << "," << g_Peers[i].numReceived << ",0,0,"
+                << g_Peers[i].numBytesReceived << "\n";
+        }
+    }
+    if (numEvents > numKept)
+    {
+        csv << processID << ",dropped,," << numEvents - numKept << ",0,0,0\n";
+    }
+
+    auto allJson = gatherText(json.str(), processID, numProcesses);
+    auto allCsv  = gatherText(csv.str(),  processID, numProcesses);
+    if (processID != 0)
+    {
+        return;
+    }
+
+    // Remove the trailing comma of the last event
+    allJson.erase(allJson.find_last_of(','));
+
+    std::ofstream jsonFile(g_OutputPrefix + ".trace.json");
+    jsonFile << "{\"traceEvents\":[\n" << allJson << "\n]}\n";
+
+    std::ofstream csvFile(g_OutputPrefix + ".csv");
+    csvFile << "rank,category,name,count,total_us,max_us,bytes\n" << allCsv;
+}
+
+void enableTracing(char const * i_OutputPrefix, uint32_t i_Capacity)
+{
+    int flag;
+    MPI_Initialized(&flag);
+    if (!flag)
+    {
+        MPI_Init(nullptr, nullptr);
+    }
+
+    int numProcesses;
+    PMPI_Comm_size(MPI_COMM_WORLD, &numProcesses);
+
+    g_OutputPrefix = i_OutputPrefix;
+    g_Events.assign(std::max(i_Capacity, 1U), TraceEvent());
+    g_NumEvents = 0;
+    g_Peers.assign(numProcesses, PeerStats());
+
+    // Use a common time origin for every process
+    PMPI_Barrier(MPI_COMM_WORLD);
+    g_Origin = PMPI_Wtime();
+    g_IsEnabled = true;
+}
+
+ScopedTimer::ScopedTimer(char const * i_Phase)
+: m_phase(i_Phase)
+, m_start(g_IsEnabled ? PMPI_Wtime() : 0.0)
+{
+}
+
+ScopedTimer::~ScopedTimer()
+{
+    if (g_IsEnabled)
+    {
+        recordEvent(m_phase, m_start, PMPI_Wtime());
+    }
+}
+
+// MPI profiling interface: the functions below replace the MPI ones and forward to PMPI
+
+int MPIAPI MPI_Send(const void * buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm)
+{
+    if (!g_IsEnabled)
+    {
+        return PMPI_Send(buf, count, datatype, dest, tag, comm);
+    }
+    auto start = PMPI_Wtime();
+    auto result = PMPI_Send(buf, count, datatype, dest, tag, comm);
+    auto end = PMPI_Wtime();
+    recordEvent("send", start, end);
+    recordSend(count, datatype, dest, comm, end - start);
+    return result;
+}
+
+int MPIAPI MPI_Isend(const void * buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm, MPI_Request * request)
+{
+    if (g_IsEnabled)
+    {
+        recordSend(count, datatype, dest, comm, 0.0);
+    }
+    return PMPI_Isend(buf, count, datatype, dest, tag, comm, request);
+}
+
+int MPIAPI MPI_Recv(void * buf, int count, MPI_Datatype datatype, int source, int tag, MPI_Comm comm, MPI_Status * status)
+{
+    if (!g_IsEnabled)
+    {
+        return PMPI_Recv(buf, count, datatype, source, tag, comm, status);
+    }
+
+    // The status gives the actual source and size of the message, even if the caller ignores it
+    MPI_Status localStatus;
+    if (status == MPI_STATUS_IGNORE)
+    {
+        status = &localStatus;
+    }
+    int result;
+    {
+        ScopedTimer timer("recv");
+        result = PMPI_Recv(buf, count, datatype, source, tag, comm, status);
+    }
+    int received;
+    PMPI_Get_count(status, datatype, &received);
+    recordReceive(received, datatype, status->MPI_SOURCE, comm);
+    return result;
+}
+
+int MPIAPI MPI_Irecv(void * buf, int count, MPI_Datatype datatype, int source, int tag, MPI_Comm comm, MPI_Request * request)
+{
+    if (g_IsEnabled)
+    {
+        recordReceive(count, datatype, source, comm);
+    }
+    return PMPI_Irecv(buf, count, datatype, source, tag, comm, request);
+}
+
+int MPIAPI MPI_Wait(MPI_Request * request, MPI_Status * status)
+{
+    ScopedTimer timer(WAIT_PHASE);
+    return PMPI_Wait(request, status);
+}
+
+int MPIAPI MPI_Waitall(int count, MPI_Request * requests, MPI_Status * statuses)
+{
+    ScopedTimer timer(WAIT_PHASE);
+    return PMPI_Waitall(count, requests, statuses);
+}
+
+int MPIAPI MPI_Test(MPI_Request * request, int * flag, MPI_Status * status)
+{
+    if (!g_IsEnabled)
+    {
+        return PMPI_Test(request, flag, status);
+    }
+    auto start = PMPI_Wtime();
+    auto result = PMPI_Test(request, flag, status);
+    recordPoll(start, PMPI_Wtime());
+    return result;
+}
+
+int MPIAPI MPI_Iprobe(int source, int tag, MPI_Comm comm, int * flag, MPI_Status * status)
+{
+    if (!g_IsEnabled)
+    {
+        return PMPI_Iprobe(source, tag, comm, flag, status);
+    }
+    auto start = PMPI_Wtime();
+    auto result = PMPI_Iprobe(source, tag, comm, flag, status);
+    recordPoll(start, PMPI_Wtime());
+    return result;
+}
+
+int MPIAPI MPI_Barrier(MPI_Comm comm)
+{
+    ScopedTimer timer("barrier");
+    return PMPI_Barrier(comm);
+}
+
+int MPIAPI MPI_Bcast(void * buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm)
+{
+    ScopedTimer timer("bcast");
+    return PMPI_Bcast(buffer, count, datatype, root, comm);
+}
+
+int MPIAPI MPI_Reduce(const void * sendbuf, void * recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
+{
+    ScopedTimer timer("reduce");
+    return PMPI_Reduce(sendbuf, recvbuf, count, datatype, op, root, comm);
+}
+
+int MPIAPI MPI_Allreduce(const void * sendbuf, void * recvbuf, int count, MPI_Datatype datatype, MPI_Op op, MPI_Comm comm)
+{
+    ScopedTimer timer("reduce");
+    return PMPI_Allreduce(sendbuf, recvbuf, count, datatype, op, comm);
+}
+
+int MPIAPI MPI_Finalize()
+{
+    if (g_IsEnabled)
+    {
+        writeTrace();
+        g_IsEnabled = false;
+    }
+    return PMPI_Finalize();
+}
\ No newline at end of file
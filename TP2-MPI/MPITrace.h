@@ -0,0 +1,34 @@
+#ifndef MPITRACE
+#define MPITRACE
+
+#include <stdint.h>
+
+// Per-process tracing of MPI programs.
+//
+// Once enabled, every blocking MPI call (send, receive, wait, collectives) is timed through the
+// MPI profiling interface, as well as polling loops of MPI_Test and MPI_Iprobe (merged into one
+// wait), bytes and messages sent to and received from each peer are counted, and user phases can
+// be timed with ScopedTimer. Records go to a fixed-size ring buffer (oldest records are dropped
+// when it is full). At MPI_Finalize, records of every process are merged by the manager into
+// <prefix>.trace.json (chrome://tracing format) and <prefix>.csv (per phase and per peer summary).
+
+// Start tracing (initializes MPI if needed). Collective over MPI_COMM_WORLD.
+void enableTracing(char const * i_OutputPrefix, uint32_t i_Capacity = 1 << 18);
+
+// Time a phase of the program from construction to destruction. i_Phase must outlive the
+// program (string literal), it is stored as is.
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(char const * i_Phase);
+    ~ScopedTimer();
+
+private:
+    ScopedTimer(ScopedTimer const &);
+    ScopedTimer & operator=(ScopedTimer const &);
+
+    char const * m_phase;
+    double       m_start;
+};
+
+#endif //MPITRACE
\ No newline at end of file
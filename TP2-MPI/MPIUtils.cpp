@@ -1,5 +1,7 @@
 #include "MPIUtils.h"
+#include <algorithm>
 #include <mpi.h>
+#include <vector>
 
 void runManagerWorkerAlgorithm(int argc, char ** argv, MPIFunc i_ManagerFunc, MPIFunc i_WorkerFunc)
 {
@@ -28,4 +30,408 @@ void runManagerWorkerAlgorithm(int argc, char ** argv, MPIFunc i_ManagerFunc, MP
     {
         MPI_Finalize();
     }
+}
+
+// Create a communicator grouping the processes that share memory with the current one
+static MPI_Comm splitByNode()
+{
+    int processID;
+    MPI_Comm_rank(MPI_COMM_WORLD, &processID);
+    MPI_Comm nodeComm;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, processID, MPI_INFO_NULL, &nodeComm);
+    return nodeComm;
+}
+
+// Tags of the messages exchanged by the hierarchical job farm
+static int const TAG_JOB          = 1;
+static int const TAG_RESULT       = 2;
+static int const TAG_BATCH_REQ    = 3;
+static int const TAG_BATCH        = 4;
+static int const TAG_LAST_RESULTS = 5;
+static int const TAG_VACATION     = 6;
+
+// Pack the inputs of the next jobs (each one prefixed by its ID) in o_Batch, return the number of jobs
+static uint32_t takeBatch(JobFarm const & i_Farm, uint32_t i_BatchSize, uint32_t & io_NextJob, std::vector<double> & o_Batch)
+{
+    auto jobSize  = i_Farm.inputSize + 1;
+    auto numTaken = std::min(i_BatchSize, i_Farm.numJobs - io_NextJob);
+    o_Batch.resize(std::max(i_BatchSize * jobSize, 1U));
+    for (auto i = 0U; i < numTaken; ++i, ++io_NextJob)
+    {
+        o_Batch[i * jobSize] = io_NextJob;
+        i_Farm.fillInput(io_NextJob, &o_Batch[i * jobSize + 1]);
+    }
+    return numTaken;
+}
+
+// Unpack results (each one prefixed by its job ID) and give them to the manager
+static void storeResults(JobFarm const & i_Farm, double const * i_Results, uint32_t i_NumResults)
+{
+    auto resultSize = i_Farm.resultSize + 1;
+    for (auto i = 0U; i < i_NumResults; ++i)
+    {
+        i_Farm.storeResult(static_cast<uint32_t>(i_Results[i * resultSize]), i_Results + i * resultSize + 1);
+    }
+}
+
+// Code executed by the first process of each node (the manager acts as the sub-manager of its own node)
+static void runNodeSubManager(JobFarm const & i_Farm, uint32_t i_BatchSize, MPI_Comm i_NodeComm, MPI_Comm i_LeadersComm)
+{
+    int nodeSize;
+    MPI_Comm_size(i_NodeComm, &nodeSize);
+    int leaderID;
+    MPI_Comm_rank(i_LeadersComm, &leaderID);
+    int numLeaders;
+    MPI_Comm_size(i_LeadersComm, &numLeaders);
+
+    auto isManager  = leaderID == MANAGER_ID;
+    auto jobSize    = i_Farm.inputSize + 1;
+    auto resultSize = i_Farm.resultSize + 1;
+
+    // Jobs of the current batch and results not yet sent to the manager
+    std::vector<double> batch(i_BatchSize * jobSize);
+    std::vector<double> results;
+    auto batchCount = 0U;
+    auto nextInBatch = 0U;
+    auto noMoreJobs = false;
+    MPI_Request batchRequest;
+    auto isBatchPending = false;
+
+    // Manager only: next job to give and number of sub-managers that are done
+    auto nextJob = 0U;
+    auto numLeadersDone = 0;
+    std::vector<double> remoteBuf;
+
+    // Processes of the node waiting for a job
+    std::vector<int> idleWorkers;
+    for (auto i = nodeSize - 1; i > 0; --i)
+    {
+        idleWorkers.push_back(i);
+    }
+
+    // Keep results locally until the next batch request (the manager stores them right away)
+    auto onResult = [&](double const * i_Result)
+    {
+        if (isManager)
+        {
+            storeResults(i_Farm, i_Result, 1);
+        }
+        else
+        {
+            results.insert(results.end(), i_Result, i_Result + resultSize);
+        }
+    };
+
+    while (true)
+    {
+        // Ask for the next batch as soon as the current one is handed out
+        if (nextInBatch == batchCount && !isBatchPending && !noMoreJobs)
+        {
+            if (isManager)
+            {
+                batchCount = takeBatch(i_Farm, i_BatchSize, nextJob, batch);
+                nextInBatch = 0;
+                noMoreJobs = batchCount == 0;
+            }
+            else
+            {
+                MPI_Send(results.data(), static_cast<int>(results.size()), MPI_DOUBLE, MANAGER_ID, TAG_BATCH_REQ, i_LeadersComm);
+                results.clear();
+                MPI_Irecv(batch.data(), static_cast<int>(batch.size()), MPI_DOUBLE, MANAGER_ID, TAG_BATCH, i_LeadersComm, &batchRequest);
+                isBatchPending = true;
+            }
+        }
+
+        // Did the manager answer our batch request ?
+        if (isBatchPending)
+        {
+            auto hasArrived = 0;
+            MPI_Status status;
+            MPI_Test(&batchRequest, &hasArrived, &status);
+            if (hasArrived)
+            {
+                int count;
+                MPI_Get_count(&status, MPI_DOUBLE, &count);
+                batchCount = count / jobSize;
+                nextInBatch = 0;
+                noMoreJobs = batchCount == 0;
+                isBatchPending = false;
+            }
+        }
+
+        // Hand out jobs to idle processes of the node
+        while (nextInBatch < batchCount && !idleWorkers.empty())
+        {
+            MPI_Send(&batch[nextInBatch * jobSize], jobSize, MPI_DOUBLE, idleWorkers.back(), TAG_JOB, i_NodeComm);
+            idleWorkers.pop_back();
+            ++nextInBatch;
+        }
+
+        // Alone on this node ? Do the work yourself
+        if (nodeSize == 1 && nextInBatch < batchCount)
+        {
+            std::vector<double> result(resultSize);
+            result[0] = batch[nextInBatch * jobSize];
+            i_Farm.compute(&batch[nextInBatch * jobSize + 1], &result[1]);
+            onResult(result.data());
+            ++nextInBatch;
+        }
+
+        // Gather results of the processes of the node
+        auto hasResult = 0;
+        MPI_Status status;
+        MPI_Iprobe(MPI_ANY_SOURCE, TAG_RESULT, i_NodeComm, &hasResult, &status);
+        if (hasResult)
+        {
+            std::vector<double> result(resultSize);
+            MPI_Recv(result.data(), resultSize, MPI_DOUBLE, status.MPI_SOURCE, TAG_RESULT, i_NodeComm, MPI_STATUS_IGNORE);
+            onResult(result.data());
+            idleWorkers.push_back(status.MPI_SOURCE);
+        }
+
+        // Manager only: serve the other sub-managers
+        if (isManager)
+        {
+            auto hasRequest = 0;
+            MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, i_LeadersComm, &hasRequest, &status);
+            if (hasRequest)
+            {
+                int count;
+                MPI_Get_count(&status, MPI_DOUBLE, &count);
+                remoteBuf.resize(std::max(count, 1));
+                MPI_Recv(remoteBuf.data(), count, MPI_DOUBLE, status.MPI_SOURCE, status.MPI_TAG, i_LeadersComm, MPI_STATUS_IGNORE);
+                storeResults(i_Farm, remoteBuf.data(), count / resultSize);
+
+                if (status.MPI_TAG == TAG_BATCH_REQ)
+                {
+                    auto numTaken = takeBatch(i_Farm, i_BatchSize, nextJob, remoteBuf);
+                    MPI_Send(remoteBuf.data(), numTaken * jobSize, MPI_DOUBLE, status.MPI_SOURCE, TAG_BATCH, i_LeadersComm);
+                }
+                else
+                {
+                    ++numLeadersDone;
+                }
+            }
+        }
+
+        // Is the work of this node over ?
+        if (noMoreJobs && idleWorkers.size() == static_cast<size_t>(nodeSize - 1))
+        {
+            if (!isManager)
+            {
+                MPI_Send(results.data(), static_cast<int>(results.size()), MPI_DOUBLE, MANAGER_ID, TAG_LAST_RESULTS, i_LeadersComm);
+                break;
+            }
+            if (numLeadersDone == numLeaders - 1)
+            {
+                break;
+            }
+        }
+    }
+
+    // Send processes of the node on vacation
+    for (auto i = 1; i < nodeSize; ++i)
+    {
+        MPI_Send(nullptr, 0, MPI_DOUBLE, i, TAG_VACATION, i_NodeComm);
+    }
+}
+
+// Code executed by every process of a node except its sub-manager
+static void runNodeWorker(JobFarm const & i_Farm, MPI_Comm i_NodeComm)
+{
+    std::vector<double> job(i_Farm.inputSize + 1);
+    std::vector<double> result(i_Farm.resultSize + 1);
+    while (true)
+    {
+        MPI_Status status;
+        MPI_Recv(job.data(), static_cast<int>(job.size()), MPI_DOUBLE, 0, MPI_ANY_TAG, i_NodeComm, &status);
+
+        // Check if there is no job left to do
+        if (status.MPI_TAG == TAG_VACATION)
+        {
+            return;
+        }
+
+        result[0] = job[0];
+        i_Farm.compute(&job[1], &result[1]);
+        MPI_Send(result.data(), static_cast<int>(result.size()), MPI_DOUBLE, 0, TAG_RESULT, i_NodeComm);
+    }
+}
+
+void runHierarchicalJobFarm(JobFarm const & i_Farm, uint32_t i_BatchSize)
+{
+    int processID;
+    MPI_Comm_rank(MPI_COMM_WORLD, &processID);
+
+    // Group processes sharing the same node
+    auto nodeComm = splitByNode();
+    int nodeID;
+    MPI_Comm_rank(nodeComm, &nodeID);
+
+    // The first process of each node is its sub-manager (ordering by rank makes the manager one of them)
+    MPI_Comm leadersComm;
+    MPI_Comm_split(MPI_COMM_WORLD, nodeID == 0 ? 0 : MPI_UNDEFINED, processID, &leadersComm);
+
+    if (nodeID == 0)
+    {
+        runNodeSubManager(i_Farm, std::max(i_BatchSize, 1U), nodeComm, leadersComm);
+        MPI_Comm_free(&leadersComm);
+    }
+    else
+    {
+        runNodeWorker(i_Farm, nodeComm);
+    }
+
+    MPI_Comm_free(&nodeComm);
+}
+
+void runSelfScheduledJobFarm(JobFarm const & i_Farm, uint32_t i_ChunkSize)
+{
+    int processID;
+    MPI_Comm_rank(MPI_COMM_WORLD, &processID);
+    auto isManager = processID == MANAGER_ID;
+    auto chunkSize = std::max(i_ChunkSize, 1U);
+
+    // Only the manager knows how many jobs there are
+    auto numJobs = i_Farm.numJobs;
+    MPI_Bcast(&numJobs, 1, MPI_UNSIGNED, MANAGER_ID, MPI_COMM_WORLD);
+
+    // The manager prepares every input in advance
+    std::vector<double> inputs;
+    std::vector<double> results;
+    uint32_t counter = 0;
+    if (isManager)
+    {
+        inputs.resize(numJobs * i_Farm.inputSize);
+        results.resize(numJobs * i_Farm.resultSize);
+        for (auto i = 0U; i < numJobs; ++i)
+        {
+            i_Farm.fillInput(i, inputs.data() + i * i_Farm.inputSize);
+        }
+    }
+
+    // Expose inputs, results and the job counter of the manager (other processes expose nothing)
+    MPI_Win inputsWin;
+    MPI_Win resultsWin;
+    MPI_Win counterWin;
+    MPI_Win_create(inputs.data(),  inputs.size()  * sizeof(double), sizeof(double), MPI_INFO_NULL, MPI_COMM_WORLD, &inputsWin);
+    MPI_Win_create(results.data(), results.size() * sizeof(double), sizeof(double), MPI_INFO_NULL, MPI_COMM_WORLD, &resultsWin);
+    MPI_Win_create(&counter, isManager ? sizeof(uint32_t) : 0, sizeof(uint32_t), MPI_INFO_NULL, MPI_COMM_WORLD, &counterWin);
+    MPI_Win_lock_all(0, inputsWin);
+    MPI_Win_lock_all(0, resultsWin);
+    MPI_Win_lock_all(0, counterWin);
+
+    std::vector<double> chunkInputs(chunkSize * i_Farm.inputSize);
+    std::vector<double> chunkResults(chunkSize * i_Farm.resultSize);
+    while (true)
+    {
+        // Claim the next chunk of jobs
+        uint32_t firstJob;
+        MPI_Fetch_and_op(&chunkSize, &firstJob, MPI_UNSIGNED, MANAGER_ID, 0, MPI_SUM, counterWin);
+        MPI_Win_flush(MANAGER_ID, counterWin);
+        if (firstJob >= numJobs)
+        {
+            break;
+        }
+        auto numTaken = std::min(chunkSize, numJobs - firstJob);
+
+        // Fetch their inputs
+        MPI_Get(chunkInputs.data(), numTaken * i_Farm.inputSize, MPI_DOUBLE, MANAGER_ID,
+                static_cast<MPI_Aint>(firstJob) * i_Farm.inputSize, numTaken * i_Farm.inputSize, MPI_DOUBLE, inputsWin);
+        MPI_Win_flush(MANAGER_ID, inputsWin);
+
+        for (auto i = 0U; i < numTaken; ++i)
+        {
+            i_Farm.compute(chunkInputs.data() + i * i_Farm.inputSize, chunkResults.data() + i * i_Farm.resultSize);
+        }
+
+        // Give results back (completed before the buffer is reused)
+        MPI_Put(chunkResults.data(), numTaken * i_Farm.resultSize, MPI_DOUBLE, MANAGER_ID,
+                static_cast<MPI_Aint>(firstJob) * i_Farm.resultSize, numTaken * i_Farm.resultSize, MPI_DOUBLE, resultsWin);
+        MPI_Win_flush(MANAGER_ID, resultsWin);
+    }
+
+    MPI_Win_unlock_all(counterWin);
+    MPI_Win_unlock_all(resultsWin);
+    MPI_Win_unlock_all(inputsWin);
+
+    // Wait for every process to be done before reading the results
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (isManager)
+    {
+        // Lock our own window to make the results put by the other processes visible locally
+        MPI_Win_lock(MPI_LOCK_EXCLUSIVE, MANAGER_ID, 0, resultsWin);
+        MPI_Win_unlock(MANAGER_ID, resultsWin);
+        for (auto i = 0U; i < numJobs; ++i)
+        {
+            i_Farm.storeResult(i, results.data() + i * i_Farm.resultSize);
+        }
+    }
+
+    MPI_Win_free(&counterWin);
+    MPI_Win_free(&resultsWin);
+    MPI_Win_free(&inputsWin);
+}
+
+// Allocate a node shared array where the first process of the node owns i_FirstSize doubles and
+// the other ones i_OtherSize
+static NodeSharedArray allocateNodeSharedArray(uint32_t i_FirstSize, uint32_t i_OtherSize)
+{
+    NodeSharedArray array;
+    array.nodeComm = splitByNode();
+    int nodeID;
+    MPI_Comm_rank(array.nodeComm, &nodeID);
+    int nodeSize;
+    MPI_Comm_size(array.nodeComm, &nodeSize);
+    array.nodeID   = nodeID;
+    array.nodeSize = nodeSize;
+
+    // Allocate our segment in the node shared memory
+    double * localBase;
+    auto localSize = nodeID == 0 ? i_FirstSize : i_OtherSize;
+    MPI_Win_allocate_shared(localSize * sizeof(double), sizeof(double), MPI_INFO_NULL,
+                            array.nodeComm, &localBase, &array.window);
+
+    // Get direct pointers to the segments of every process of the node
+    array.segments.resize(nodeSize);
+    array.sizes.resize(nodeSize);
+    for (auto i = 0; i < nodeSize; ++i)
+    {
+        MPI_Aint size;
+        int      dispUnit;
+        MPI_Win_shared_query(array.window, i, &size, &dispUnit, &array.segments[i]);
+        array.sizes[i] = static_cast<uint32_t>(size / sizeof(double));
+    }
+
+    // Keep a passive epoch open for the whole lifetime of the array: synchronization is done
+    // with syncNodeSharedArray() instead of fences
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, array.window);
+
+    return array;
+}
+
+NodeSharedArray createNodeSharedArray(uint32_t i_LocalSize)
+{
+    return allocateNodeSharedArray(i_LocalSize, i_LocalSize);
+}
+
+NodeSharedArray createNodeSharedCopy(uint32_t i_Size)
+{
+    return allocateNodeSharedArray(i_Size, 0);
+}
+
+void syncNodeSharedArray(NodeSharedArray & io_Array)
+{
+    MPI_Win_sync(io_Array.window);
+    MPI_Barrier(io_Array.nodeComm);
+    MPI_Win_sync(io_Array.window);
+}
+
+void freeNodeSharedArray(NodeSharedArray & io_Array)
+{
+    MPI_Win_unlock_all(io_Array.window);
+    MPI_Win_free(&io_Array.window);
+    MPI_Comm_free(&io_Array.nodeComm);
+    io_Array.segments.clear();
+    io_Array.sizes.clear();
 }
\ No newline at end of file
@@ -2,7 +2,9 @@
 #define MPIUTILS
 
 #include <functional>
+#include <mpi.h>
 #include <stdint.h>
+#include <vector>
 
 uint32_t const MANAGER_ID = 0;
 
@@ -10,4 +12,70 @@ typedef std::function<void(uint32_t i_CurrProc, uint32_t i_NumProc)> MPIFunc;
 
 void runManagerWorkerAlgorithm(int argc, char ** argv, MPIFunc i_ManagerFunc, MPIFunc i_WorkerFunc);
 
+// Description of a manager/worker job farm. Jobs are identified by their index in [0, numJobs[
+// and exchange fixed-size buffers of doubles.
+struct JobFarm
+{
+    // Number of jobs to compute (only needs to be valid on the manager)
+    uint32_t numJobs;
+
+    // Number of doubles in the input and in the result of one job (must be valid on every process)
+    uint32_t inputSize;
+    uint32_t resultSize;
+
+    // Manager side: write the input of a job
+    std::function<void(uint32_t i_JobID, double * o_Input)> fillInput;
+
+    // Worker side: compute the result of a job from its input
+    std::function<void(double const * i_Input, double * o_Result)> compute;
+
+    // Manager side: store the result of a job
+    std::function<void(uint32_t i_JobID, double const * i_Result)> storeResult;
+};
+
+// Run a job farm where the manager only talks to one sub-manager per node. Processes are split
+// by shared-memory node, the first process of each node pulls batches of i_BatchSize jobs from
+// the manager, hands them out to the processes of its node and sends the results back with its
+// next batch request. Collective over MPI_COMM_WORLD: every process must call it.
+void runHierarchicalJobFarm(JobFarm const & i_Farm, uint32_t i_BatchSize);
+
+// Run a job farm without any manager round trip. The manager exposes the inputs of every job
+// and a job counter in RMA windows: each process (manager included) claims the next i_ChunkSize
+// jobs with an atomic fetch-and-add on the counter, gets their inputs and puts their results
+// back by itself. Results are stored by the manager once every job is done.
+// Collective over MPI_COMM_WORLD: every process must call it.
+void runSelfScheduledJobFarm(JobFarm const & i_Farm, uint32_t i_ChunkSize);
+
+// Array of doubles living in memory shared by every process of a node. Each process owns one
+// contiguous segment and can read or write the segments of the other processes of its node
+// directly, without any message. Segments are laid out in node order, so the whole node array
+// can also be indexed from segments[0].
+struct NodeSharedArray
+{
+    MPI_Comm nodeComm;
+    MPI_Win  window;
+    uint32_t nodeID;
+    uint32_t nodeSize;
+
+    // Base pointer and number of doubles of the segment of each process of the node
+    std::vector<double *> segments;
+    std::vector<uint32_t> sizes;
+};
+
+// Allocate a node shared array where the current process owns i_LocalSize doubles (may be 0).
+// Collective over MPI_COMM_WORLD.
+NodeSharedArray createNodeSharedArray(uint32_t i_LocalSize);
+
+// Allocate a node shared array of i_Size doubles owned by the first process of the node (the
+// other ones own empty segments): one copy per node of data read by all its processes.
+// Collective over MPI_COMM_WORLD.
+NodeSharedArray createNodeSharedCopy(uint32_t i_Size);
+
+// Make every write done so far by the processes of the node visible to all of them.
+// Collective over the node.
+void syncNodeSharedArray(NodeSharedArray & io_Array);
+
+// Release a node shared array. Collective over MPI_COMM_WORLD.
+void freeNodeSharedArray(NodeSharedArray & io_Array);
+
 #endif //MPIUTILS
\ No newline at end of file
@@ -0,0 +1,366 @@
+#include "../Common/Encode.h"
+#include "../Common/EncodeBatch.h"
+#include "../Common/Keyspace.h"
+#include "../Common/Search.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Benchmark of the encoder and of the brute-force search.
+//
+// Usage: Benchmark [--output FILE] [--repetitions COUNT] [--max-threads COUNT]
+//
+// Three groups of measures are written as one JSON object (to stdout by default):
+//  - primitives: ns per call of each step of encode() on std::string (add, xorx, shift, swap,
+//    getKey) and of encode() itself, for several message lengths
+//  - encoders: candidates per second of the std::string encoder, of the fixed-size encoder and
+//    of the SIMD batch encoder, for several message lengths
+//  - search: candidates per second of the search engine of the Multithreaded program (its chunk
+//    scheduler and batch search, see Common/Search.h) from 1 thread to all cores
+// Every measure is run once to warm up, then repeated; each repetition is calibrated to last at
+// least MIN_REPETITION_TIME. The median, the 10th and 90th percentiles and the minimum of the
+// repetitions are reported so runs can be compared (see compare.py).
+
+// Shortest duration of a repetition
+auto const MIN_REPETITION_TIME = std::chrono::milliseconds(20);
+
+// Number of possible solutions the batch encoder encodes at once
+size_t const BATCH_WIDTH = SEARCH_BATCH_WIDTH;
+
+// Number of possible solutions a search thread claims at once (as in the Multithreaded program)
+uint64_t const CHUNK_SIZE = 1 << 16;
+
+// Keyspace of the search benchmark: 6 lowercase letters
+char const SEARCH_MASK[] = "?l?l?l?l?l?l";
+
+// Number of repetitions of each measure
+static uint32_t g_NumRepetitions = 15;
+
+// Results are accumulated here so the compiler cannot remove the measured code
+static volatile uint32_t g_Sink;
+
+// Statistics of the repetitions of a measure (in the unit of the measure)
+struct Stats
+{
+    double median;
+    double p10;
+    double p90;
+    double min;
+    double max;
+};
+
+static Stats getStats(std::vector<double> io_Values)
+{
+    std::sort(io_Values.begin(), io_Values.end());
+    auto percentile = [&](double i_Fraction)
+    {
+        return io_Values[static_cast<size_t>(i_Fraction * (io_Values.size() - 1) + 0.5)];
+    };
+    Stats stats = { percentile(0.5), percentile(0.1), percentile(0.9), io_Values.front(), io_Values.back() };
+    return stats;
+}
+
+// Measure the time per call of i_Function (called with the number of calls to make and returning
+// a value to sink), in ns
+template <typename Function>
+static Stats measureNsPerCall(Function i_Function)
+{
+    using namespace std::chrono;
+
+    // Warm up, and find how many calls last at least MIN_REPETITION_TIME
+    uint64_t numCalls = 1;
+    for (;;)
+    {
+        auto start = steady_clock::now();
+        g_Sink += i_Function(numCalls);
+        if (steady_clock::now() - start >= MIN_REPETITION_TIME)
+        {
+            break;
+        }
+        numCalls *= 2;
+    }
+
+    std::vector<double> nsPerCall;
+    for (auto i = 0U; i < g_NumRepetitions; ++i)
+    {
+        auto start = steady_clock::now();
+        g_Sink += i_Function(numCalls);
+        nsPerCall.push_back(duration<double, std::nano>(steady_clock::now() - start).count() / numCalls);
+    }
+    return getStats(nsPerCall);
+}
+
+// Rate statistics (calls per second) from time statistics (ns per call)
+static Stats toRate(Stats const & i_NsPerCall)
+{
+    Stats rate = { 1e9 / i_NsPerCall.median, 1e9 / i_NsPerCall.p90, 1e9 / i_NsPerCall.p10,
+                   1e9 / i_NsPerCall.max, 1e9 / i_NsPerCall.min };
+    return rate;
+}
+
+static void writeStats(FILE * o_File, char const * i_Name, Stats const & i_Stats)
+{
+    fprintf(o_File, "\"%s\":{\"median\":%.6g,\"p10\":%.6g,\"p90\":%.6g,\"min\":%.6g,\"max\":%.6g}",
+            i_Name, i_Stats.median, i_Stats.p10, i_Stats.p90, i_Stats.min, i_Stats.max);
+}
+
+// Message of i_Length lowercase letters, different for each i_Seed
+static std::string getMessage(size_t i_Length, uint64_t i_Seed)
+{
+    std::string message(i_Length, 'a');
+    for (auto i = 0U; i < i_Length; ++i)
+    {
+        message[i] = static_cast<char>('a' + (i_Seed + 7 * i) % 26);
+    }
+    return message;
+}
+
+static void benchPrimitives(FILE * o_File, size_t i_Length)
+{
+    auto message = getMessage(i_Length, 0);
+    auto key = message;
+
+    // Each call changes the message so calls depend on each other and cannot be merged
+    auto add = [&](uint64_t i_NumCalls)
+    {
+        for (auto i = 0ULL; i < i_NumCalls; ++i) ::add(message, static_cast<uint8_t>(i % 4 + 1));
+        return static_cast<uint32_t>(message[0]);
+    };
+    auto xorx = [&](uint64_t i_NumCalls)
+    {
+        for (auto i = 0ULL; i < i_NumCalls; ++i) ::xorx(message, key);
+        return static_cast<uint32_t>(message[0]);
+    };
+    auto shift = [&](uint64_t i_NumCalls)
+    {
+        for (auto i = 0ULL; i < i_NumCalls; ++i) ::shift(message, static_cast<uint8_t>(i % 3));
+        return static_cast<uint32_t>(message[0]);
+    };
+    auto swap = [&](uint64_t i_NumCalls)
+    {
+        for (auto i = 0ULL; i < i_NumCalls; ++i) ::swap(message, static_cast<uint8_t>(i % 4 + 1));
+        return static_cast<uint32_t>(message[0]);
+    };
+    auto getKey = [&](uint64_t i_NumCalls)
+    {
+        auto sum = 0U;
+        for (auto i = 0ULL; i < i_NumCalls; ++i)
+        {
+            message[i % i_Length] += static_cast<char>(sum);
+            sum += ::getKey(message);
+        }
+        return sum;
+    };
+    auto encode = [&](uint64_t i_NumCalls)
+    {
+        for (auto i = 0ULL; i < i_NumCalls; ++i) message = ::encode(message);
+        return static_cast<uint32_t>(message[0]);
+    };
+
+    fprintf(o_File, "{\"length\":%u,", static_cast<unsigned int>(i_Length));
+    writeStats(o_File, "add_ns",    measureNsPerCall(add));    fprintf(o_File, ",");
+    writeStats(o_File, "xorx_ns",   measureNsPerCall(xorx));   fprintf(o_File, ",");
+    writeStats(o_File, "shift_ns",  measureNsPerCall(shift));  fprintf(o_File, ",");
+    writeStats(o_File, "swap_ns",   measureNsPerCall(swap));   fprintf(o_File, ",");
+    writeStats(o_File, "getKey_ns", measureNsPerCall(getKey)); fprintf(o_File, ",");
+    writeStats(o_File, "encode_ns", measureNsPerCall(encode));
+    fprintf(o_File, "}");
+}
+
+template <size_t N>
+static void benchEncoders(FILE * o_File)
+{
+    // std::string encoder
+    auto message = getMessage(N, 0);
+    auto stringEncoder = [&](uint64_t i_NumCalls)
+    {
+        auto sum = 0U;
+        for (auto i = 0ULL; i < i_NumCalls; ++i)
+        {
+            message[i % N] = static_cast<char>('a' + i % 26);
+            sum += static_cast<uint8_t>(encode(message)[0]);
+        }
+        return sum;
+    };
+
+    // Fixed-size encoder
+    char pw[N];
+    std::copy(message.begin(), message.end(), pw);
+    auto fixedEncoder = [&](uint64_t i_NumCalls)
+    {
+        auto sum = 0U;
+        char encoded[N];
+        for (auto i = 0ULL; i < i_NumCalls; ++i)
+        {
+            pw[i % N] = static_cast<char>('a' + i % 26);
+            encode<N>(pw, encoded);
+            sum += static_cast<uint8_t>(encoded[0]);
+        }
+        return sum;
+    };
+
+    // Batch encoder (one call encodes BATCH_WIDTH candidates)
+    CandidateBatch<N, BATCH_WIDTH> batch;
+    for (auto i = 0U; i < N; ++i)
+    {
+        for (auto lane = 0U; lane < BATCH_WIDTH; ++lane)
+        {
+            batch.chars[i][lane] = static_cast<uint8_t>('a' + (i + lane) % 26);
+        }
+    }
+    auto batchEncoder = [&](uint64_t i_NumCalls)
+    {
+        auto sum = 0U;
+        CandidateBatch<N, BATCH_WIDTH> encoded;
+        for (auto i = 0ULL; i < i_NumCalls; ++i)
+        {
+            batch.chars[i % N][i % BATCH_WIDTH] = static_cast<uint8_t>('a' + i % 26);
+            encodeBatch<N, BATCH_WIDTH>(batch, encoded);
+            sum += encoded.chars[0][0];
+        }
+        return sum;
+    };
+
+    auto batchRate = toRate(measureNsPerCall(batchEncoder));
+    batchRate.median *= BATCH_WIDTH;
+    batchRate.p10    *= BATCH_WIDTH;
+    batchRate.p90    *= BATCH_WIDTH;
+    batchRate.min    *= BATCH_WIDTH;
+    batchRate.max    *= BATCH_WIDTH;
+
+    fprintf(o_File, "{\"length\":%u,", static_cast<unsigned int>(N));
+    writeStats(o_File, "string_per_s", toRate(measureNsPerCall(stringEncoder))); fprintf(o_File, ",");
+    writeStats(o_File, "fixed_per_s",  toRate(measureNsPerCall(fixedEncoder)));  fprintf(o_File, ",");
+    writeStats(o_File, "batch_per_s",  batchRate);
+    fprintf(o_File, "}");
+}
+
+// Candidates per second of i_NumThreads threads searching the first i_NumCandidates candidates of
+// SEARCH_MASK for a target none of them encodes to, with the engine of the Multithreaded program
+static double runSearch(uint32_t i_NumThreads, uint64_t i_NumCandidates)
+{
+    Keyspace keyspace(SEARCH_MASK);
+    std::atomic<uint32_t> numMatches(0);
+    KeyspaceSearch search(std::string(keyspace.getMaxLength(), '\0'), nullptr,
+        [&](uint16_t, char const *, char const *, size_t) { numMatches.fetch_add(1, std::memory_order_relaxed); });
+    ChunkScheduler scheduler;
+    scheduler.reset(0, i_NumCandidates);
+
+    auto worker = [&](uint16_t i_ID)
+    {
+        uint64_t first;
+        uint64_t last;
+        while (scheduler.claimChunk(i_ID, CHUNK_SIZE, first, last))
+        {
+            search.searchRange(keyspace, first, last, i_ID);
+        }
+    };
+
+    using namespace std::chrono;
+    auto start = steady_clock::now();
+    std::vector<std::thread> threads;
+    for (auto i = 0U; i < i_NumThreads; ++i)
+    {
+        threads.emplace_back(worker, static_cast<uint16_t>(i));
+    }
+    for (auto & thread : threads)
+    {
+        thread.join();
+    }
+    g_Sink += numMatches;
+    return i_NumCandidates / duration<double>(steady_clock::now() - start).count();
+}
+
+static void benchSearch(FILE * o_File, uint32_t i_NumThreads)
+{
+    // Size the search so one repetition lasts about MIN_REPETITION_TIME * 10 (plenty of chunks),
+    // within the keyspace
+    auto maxCandidates = Keyspace(SEARCH_MASK).getSize();
+    auto numCandidates = std::min<uint64_t>(std::max<uint64_t>(CHUNK_SIZE * i_NumThreads, 1 << 20), maxCandidates);
+    while (runSearch(i_NumThreads, numCandidates) * 0.2 > numCandidates && numCandidates < maxCandidates)
+    {
+        numCandidates = std::min(2 * numCandidates, maxCandidates);
+    }
+
+    std::vector<double> rates;
+    for (auto i = 0U; i < g_NumRepetitions; ++i)
+    {
+        rates.push_back(runSearch(i_NumThreads, numCandidates));
+    }
+
+    fprintf(o_File, "{\"threads\":%u,\"candidates\":%llu,", i_NumThreads, static_cast<unsigned long long>(numCandidates));
+    writeStats(o_File, "candidates_per_s", getStats(rates));
+    fprintf(o_File, "}");
+}
+
+int main(int argc, char ** argv)
+{
+    FILE * output = stdout;
+    auto maxThreads = std::max(std::thread::hardware_concurrency(), 1U);
+    for (auto i = 1; i < argc; i += 2)
+    {
+        if (i + 1 < argc && strcmp(argv[i], "--output") == 0)
+        {
+            output = fopen(argv[i + 1], "w");
+            if (!output)
+            {
+                fprintf(stderr, "Cannot write %s\n", argv[i + 1]);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (i + 1 < argc && strcmp(argv[i], "--repetitions") == 0)
+        {
+            g_NumRepetitions = std::max(atoi(argv[i + 1]), 1);
+        }
+        else if (i + 1 < argc && strcmp(argv[i], "--max-threads") == 0)
+        {
+            maxThreads = std::max(atoi(argv[i + 1]), 1);
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--output FILE] [--repetitions COUNT] [--max-threads COUNT]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    fprintf(output, "{\"batch_width\":%u,\"hardware_threads\":%u,\"repetitions\":%u,\n",
+            static_cast<unsigned int>(BATCH_WIDTH), std::thread::hardware_concurrency(), g_NumRepetitions);
+
+    fprintf(output, "\"primitives\":[\n");
+    size_t const lengths[] = { 4, 6, 8, 12, 16 };
+    for (auto i = 0U; i < sizeof(lengths) / sizeof(lengths[0]); ++i)
+    {
+        benchPrimitives(output, lengths[i]);
+        fprintf(output, i + 1 < sizeof(lengths) / sizeof(lengths[0]) ? ",\n" : "\n");
+    }
+
+    fprintf(output, "],\n\"encoders\":[\n");
+    benchEncoders<4> (output); fprintf(output, ",\n");
+    benchEncoders<6> (output); fprintf(output, ",\n");
+    benchEncoders<8> (output); fprintf(output, ",\n");
+    benchEncoders<12>(output); fprintf(output, ",\n");
+    benchEncoders<16>(output); fprintf(output, "\n");
+
+    // 1 thread, then powers of two, then all cores
+    fprintf(output, "],\n\"search\":[\n");
+    for (auto numThreads = 1U; ; numThreads = std::min(2 * numThreads, maxThreads))
+    {
+        benchSearch(output, numThreads);
+        if (numThreads == maxThreads)
+        {
+            break;
+        }
+        fprintf(output, ",\n");
+    }
+    fprintf(output, "\n]}\n");
+
+    if (output != stdout)
+    {
+        fclose(output);
+    }
+}
@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+"""Compare two runs of the Benchmark executable and flag regressions.
+
+Every measure found in both files is compared on its median. Times (*_ns) regress when they grow,
+rates (*_per_s) regress when they shrink. A change is only reported as a regression when it is
+larger than --threshold and the ranges [p10, p90] of the two runs do not overlap, so that noise
+between runs is not flagged. Measures whose baseline median is 0 (below the timer resolution) have
+no relative change: they are listed as skipped.
+
+Exits with 1 if any measure regressed, so it can gate a build.
+
+Example: python compare.py baseline.json current.json --threshold 0.05
+"""
+
+import argparse
+import json
+import sys
+
+
+def measures(run):
+    """Yield (name, stats, higher_is_better) for every measure of a run."""
+    for section, key in (("primitives", "length"), ("encoders", "length"), ("search", "threads")):
+        for entry in run.get(section, []):
+            for name, stats in entry.items():
+                if isinstance(stats, dict):
+                    yield "%s[%s=%s].%s" % (section, key, entry[key], name), stats, name.endswith("_per_s")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=0.05, help="relative change flagged (default 0.05)")
+    args = parser.parse_args()
+
+    with open(args.baseline) as file:
+        baseline = {name: stats for name, stats, _ in measures(json.load(file))}
+    with open(args.current) as file:
+        current = list(measures(json.load(file)))
+
+    num_regressions = 0
+    for name, stats, higher_is_better in current:
+        if name not in baseline:
+            continue
+        old = baseline[name]
+        if old["median"] == 0:
+            print("%-45s %12.4g %12.4g %8s skipped (zero baseline)" % (name, old["median"], stats["median"], ""))
+            continue
+        change = stats["median"] / old["median"] - 1
+        worse = -change if higher_is_better else change
+        overlap = stats["p10"] <= old["p90"] and old["p10"] <= stats["p90"]
+        if worse > args.threshold and not overlap:
+            status = "REGRESSION"
+            num_regressions += 1
+        elif -worse > args.threshold and not overlap:
+            status = "improvement"
+        else:
+            status = ""
+        print("%-45s %12.4g %12.4g %+7.1f%% %s" % (name, old["median"], stats["median"], 100 * change, status))
+
+    print("%d regression(s)" % num_regressions)
+    return 1 if num_regressions > 0 else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
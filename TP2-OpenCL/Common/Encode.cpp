@@ -1,4 +1,5 @@
 #include "Encode.h"
+#include <algorithm>
 
 void add(std::string & io_PW, uint8_t i_Key)
 {
@@ -18,21 +19,13 @@ void xorx(std::string & io_PW, std::string const & i_Key)
     }
 }
 
+// Rotate right by i_Offset characters (modulo the length, as the fixed-size encoder does)
 void shift(std::string & io_PW, uint8_t i_Offset)
 {
-    char temp[2];
-    auto max = io_PW.length() - 1;
-    for (auto i = 0U; i < i_Offset; ++i)
-    {
-        temp[i] = io_PW[max - i];
-    }
-    for (int i = max; i >= static_cast<int>(i_Offset); --i)
-    {
-        io_PW[i] = io_PW[i - i_Offset];
-    }
-    for (auto i = 0U; i < i_Offset; ++i)
+    auto len = io_PW.length();
+    if (len > 0)
     {
-        io_PW[i] = temp[i_Offset - i - 1];
+        std::rotate(io_PW.begin(), io_PW.end() - i_Offset % len, io_PW.end());
     }
 }
 
@@ -73,3 +66,24 @@ std::string encode(std::string const & i_PW)
 
     return encoded;
 }
+
+void getRoundTables(size_t i_Length, uint8_t i_Key, uint8_t * o_Source, uint8_t * o_Offset)
+{
+    // Run the steps that move characters on their positions, and the ones that change them on zeros
+    std::string positions(i_Length, 0);
+    std::string offsets(i_Length, 0);
+    for (auto i = 0U; i < i_Length; ++i)
+    {
+        positions[i] = static_cast<char>(i);
+    }
+    shift(positions, i_Key / 2);
+    swap (positions, i_Key);
+    add  (offsets,   i_Key);
+    swap (offsets,   i_Key);
+
+    for (auto i = 0U; i < i_Length; ++i)
+    {
+        o_Source[i] = static_cast<uint8_t>(positions[i]);
+        o_Offset[i] = static_cast<uint8_t>(offsets[i]);
+    }
+}
@@ -1,9 +1,228 @@
 #ifndef ENCODE_IFT630
 #define ENCODE_IFT630
 
+#include <array>
 #include <string>
+#include <type_traits>
 #include <stdint.h>
 
+#if defined(__SSSE3__) || defined(__AVX__)
+#include <tmmintrin.h>
+#endif
+
 std::string encode(std::string const & i_PW);
 
+// Steps of encode()
+void add(std::string & io_PW, uint8_t i_Key);
+void xorx(std::string & io_PW, std::string const & i_Key);
+void shift(std::string & io_PW, uint8_t i_Offset);
+void swap(std::string & io_PW, uint8_t i_Offset);
+uint8_t getKey(std::string const & i_PW);
+
+// Describe a round of encode() with key i_Key on messages of i_Length characters: character i
+// of the round output is (input[o_Source[i]] + o_Offset[i]) ^ message[i]. Arrays hold i_Length
+// entries.
+void getRoundTables(size_t i_Length, uint8_t i_Key, uint8_t * o_Source, uint8_t * o_Offset);
+
+// Allocation-free encoder specialized for messages of N characters. It gives the same result as
+// encode(std::string) but works on fixed-size buffers so loops are fully unrolled by the compiler.
+// Buffers given to it must not overlap.
+
+template <size_t N>
+inline void add(char * io_PW, uint8_t i_Key)
+{
+    for (auto i = 0U; i < N; ++i)
+    {
+        io_PW[i] += i_Key * i;
+    }
+}
+
+template <size_t N>
+inline void xorx(char * io_PW, char const * i_Key)
+{
+    for (auto i = 0U; i < N; ++i)
+    {
+        io_PW[i] ^= i_Key[i];
+    }
+}
+
+// Rotate right by i_Offset characters
+template <size_t N>
+inline void shift(char * io_PW, uint8_t i_Offset)
+{
+    char temp[N];
+    for (auto i = 0U; i < N; ++i)
+    {
+        temp[(i + i_Offset) % N] = io_PW[i];
+    }
+    for (auto i = 0U; i < N; ++i)
+    {
+        io_PW[i] = temp[i];
+    }
+}
+
+template <size_t N>
+inline void swap(char * io_PW, uint8_t i_Offset)
+{
+    for (auto i = 0U; i + i_Offset < N; ++i)
+    {
+        auto temp = io_PW[i];
+        io_PW[i] = io_PW[i + i_Offset];
+        io_PW[i + i_Offset] = temp;
+    }
+}
+
+template <size_t N>
+inline uint8_t getKey(char const * i_PW)
+{
+    auto temp = 0U;
+    for (auto i = 0U; i < N; ++i)
+    {
+        temp += static_cast<unsigned int>(i_PW[i]);
+    }
+    return static_cast<uint8_t>(temp % 4 + 1);
+}
+
+// Each round of encode() only depends on its key (1 to 4): shift and swap move characters to
+// fixed positions and add gives each position a fixed offset. For every key, the tables hold
+// the composed permutation (the position each character comes from) and the offsets, so a
+// round becomes one gather (a single byte shuffle for messages up to 16 characters), one
+// addition and one xor. Unused entries select nothing and add nothing.
+template <size_t N>
+struct EncodeTables
+{
+    static size_t const SIZE = N < 16 ? 16 : N;
+
+    alignas(16) uint8_t source[4][SIZE];
+    alignas(16) uint8_t offset[4][SIZE];
+
+    // Build the tables by running the steps of a round on positions and on zeros
+    EncodeTables()
+    {
+        for (auto k = 0U; k < 4; ++k)
+        {
+            auto key = static_cast<uint8_t>(k + 1);
+            char positions[N];
+            char offsets[N];
+            for (auto i = 0U; i < N; ++i)
+            {
+                positions[i] = static_cast<char>(i);
+                offsets[i] = 0;
+            }
+            shift<N>(positions, key / 2);
+            swap <N>(positions, key);
+            add  <N>(offsets,   key);
+            swap <N>(offsets,   key);
+
+            for (auto i = 0U; i < SIZE; ++i)
+            {
+                source[k][i] = i < N ? static_cast<uint8_t>(positions[i]) : 0x80;
+                offset[k][i] = i < N ? static_cast<uint8_t>(offsets[i])   : 0;
+            }
+        }
+    }
+
+    static EncodeTables const & get()
+    {
+        static EncodeTables const tables;
+        return tables;
+    }
+};
+
+#if defined(__SSSE3__) || defined(__AVX__)
+// Messages of up to 16 characters fit in one SSE register: a round is a pshufb, an add and a xor
+template <size_t N>
+inline typename std::enable_if<N <= 16>::type encodeRounds(char const * i_PW, char * o_Encoded)
+{
+    auto const & tables = EncodeTables<N>::get();
+
+    alignas(16) char buf[16] = {};
+    for (auto i = 0U; i < N; ++i)
+    {
+        buf[i] = i_PW[i];
+    }
+    auto pw = _mm_load_si128(reinterpret_cast<__m128i const *>(buf));
+    auto encoded = pw;
+
+    for (auto i = 0U; i < 3; ++i)
+    {
+        // Characters past the message are zero, so the sum of the 16 bytes is the one of the message
+        auto sums = _mm_sad_epu8(encoded, _mm_setzero_si128());
+        auto k = (_mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4)) & 3;
+
+        encoded = _mm_shuffle_epi8(encoded, _mm_load_si128(reinterpret_cast<__m128i const *>(tables.source[k])));
+        encoded = _mm_add_epi8    (encoded, _mm_load_si128(reinterpret_cast<__m128i const *>(tables.offset[k])));
+        encoded = _mm_xor_si128   (encoded, pw);
+    }
+
+    _mm_store_si128(reinterpret_cast<__m128i *>(buf), encoded);
+    for (auto i = 0U; i < N; ++i)
+    {
+        o_Encoded[i] = buf[i];
+    }
+}
+
+template <size_t N>
+inline typename std::enable_if<(N > 16)>::type encodeRounds(char const * i_PW, char * o_Encoded)
+#else
+template <size_t N>
+inline void encodeRounds(char const * i_PW, char * o_Encoded)
+#endif
+{
+    auto const & tables = EncodeTables<N>::get();
+
+    char encoded[N];
+    for (auto i = 0U; i < N; ++i)
+    {
+        encoded[i] = i_PW[i];
+    }
+
+    for (auto i = 0U; i < 3; ++i)
+    {
+        auto k = getKey<N>(encoded) - 1;
+        for (auto j = 0U; j < N; ++j)
+        {
+            o_Encoded[j] = (encoded[tables.source[k][j]] + tables.offset[k][j]) ^ i_PW[j];
+        }
+        for (auto j = 0U; j < N; ++j)
+        {
+            encoded[j] = o_Encoded[j];
+        }
+    }
+}
+
+// Encode the N characters of i_PW in o_Encoded
+template <size_t N>
+inline void encode(char const * i_PW, char * o_Encoded)
+{
+    encodeRounds<N>(i_PW, o_Encoded);
+}
+
+template <size_t N>
+inline void encode(std::array<char, N> const & i_PW, std::array<char, N> & o_Encoded)
+{
+    encode<N>(i_PW.data(), o_Encoded.data());
+}
+
+// Check if the N characters of i_PW are encoded as i_Target
+template <size_t N>
+inline bool encodesTo(char const * i_PW, char const * i_Target)
+{
+    char encoded[N];
+    encode<N>(i_PW, encoded);
+
+    auto isSame = true;
+    for (auto i = 0U; i < N; ++i)
+    {
+        isSame &= encoded[i] == i_Target[i];
+    }
+    return isSame;
+}
+
+template <size_t N>
+inline bool encodesTo(std::array<char, N> const & i_PW, std::array<char, N> const & i_Target)
+{
+    return encodesTo<N>(i_PW.data(), i_Target.data());
+}
+
 #endif //ENCODE_IFT630
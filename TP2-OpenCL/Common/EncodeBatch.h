@@ -0,0 +1,211 @@
+#ifndef ENCODE_BATCH_IFT630
+#define ENCODE_BATCH_IFT630
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(__AVX2__) || defined(__AVX512BW__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ENCODE_BATCH_SSE2
+#endif
+
+// Batch encoder: encodes W candidates of N characters at once, one candidate per byte lane of
+// a SIMD register. Candidates are stored transposed (struct of arrays) so that each step of
+// encode() becomes a few byte-wise vector operations applied to every lane:
+//  - getKey is a per-lane sum (only its value modulo 4 matters, so byte additions are enough)
+//  - shift and swap become per-lane selections between the few permutations a key can give
+//  - add and xorx are plain byte additions and xors
+
+// Widest batch supported natively by the target instruction set
+#if defined(__AVX512BW__)
+size_t const NATIVE_BATCH_WIDTH = 64;
+#elif defined(__AVX2__)
+size_t const NATIVE_BATCH_WIDTH = 32;
+#else
+size_t const NATIVE_BATCH_WIDTH = 16;
+#endif
+
+// W candidates of N characters: chars[p][lane] is character p of candidate lane
+template <size_t N, size_t W>
+struct CandidateBatch
+{
+    alignas(64) uint8_t chars[N][W];
+};
+
+// W byte lanes. The generic version is written so compilers can auto-vectorize it, the
+// specializations below map directly to SSE2, AVX2 and AVX-512 registers.
+template <size_t W>
+struct ByteLanes
+{
+    uint8_t v[W];
+
+    static ByteLanes load(uint8_t const * i_Src) { ByteLanes r; for (auto i = 0U; i < W; ++i) r.v[i] = i_Src[i]; return r; }
+    static ByteLanes set(uint8_t i_Val) { ByteLanes r; for (auto i = 0U; i < W; ++i) r.v[i] = i_Val; return r; }
+    void store(uint8_t * o_Dst) const { for (auto i = 0U; i < W; ++i) o_Dst[i] = v[i]; }
+    ByteLanes operator+(ByteLanes const & i_O) const { ByteLanes r; for (auto i = 0U; i < W; ++i) r.v[i] = v[i] + i_O.v[i]; return r; }
+    ByteLanes operator^(ByteLanes const & i_O) const { ByteLanes r; for (auto i = 0U; i < W; ++i) r.v[i] = v[i] ^ i_O.v[i]; return r; }
+    ByteLanes operator&(ByteLanes const & i_O) const { ByteLanes r; for (auto i = 0U; i < W; ++i) r.v[i] = v[i] & i_O.v[i]; return r; }
+    ByteLanes operator|(ByteLanes const & i_O) const { ByteLanes r; for (auto i = 0U; i < W; ++i) r.v[i] = v[i] | i_O.v[i]; return r; }
+    ByteLanes operator==(ByteLanes const & i_O) const { ByteLanes r; for (auto i = 0U; i < W; ++i) r.v[i] = v[i] == i_O.v[i] ? 0xFF : 0; return r; }
+    uint64_t mask() const { uint64_t m = 0; for (auto i = 0U; i < W; ++i) m |= static_cast<uint64_t>(v[i] >> 7) << i; return m; }
+};
+
+#if defined(ENCODE_BATCH_SSE2) || defined(__AVX2__) || defined(__AVX512BW__)
+template <>
+struct ByteLanes<16>
+{
+    __m128i v;
+
+    static ByteLanes load(uint8_t const * i_Src) { return { _mm_load_si128(reinterpret_cast<__m128i const *>(i_Src)) }; }
+    static ByteLanes set(uint8_t i_Val) { return { _mm_set1_epi8(static_cast<char>(i_Val)) }; }
+    void store(uint8_t * o_Dst) const { _mm_store_si128(reinterpret_cast<__m128i *>(o_Dst), v); }
+    ByteLanes operator+(ByteLanes const & i_O) const { return { _mm_add_epi8(v, i_O.v) }; }
+    ByteLanes operator^(ByteLanes const & i_O) const { return { _mm_xor_si128(v, i_O.v) }; }
+    ByteLanes operator&(ByteLanes const & i_O) const { return { _mm_and_si128(v, i_O.v) }; }
+    ByteLanes operator|(ByteLanes const & i_O) const { return { _mm_or_si128(v, i_O.v) }; }
+    ByteLanes operator==(ByteLanes const & i_O) const { return { _mm_cmpeq_epi8(v, i_O.v) }; }
+    uint64_t mask() const { return static_cast<uint32_t>(_mm_movemask_epi8(v)); }
+};
+#endif
+
+#if defined(__AVX2__) || defined(__AVX512BW__)
+template <>
+struct ByteLanes<32>
+{
+    __m256i v;
+
+    static ByteLanes load(uint8_t const * i_Src) { return { _mm256_load_si256(reinterpret_cast<__m256i const *>(i_Src)) }; }
+    static ByteLanes set(uint8_t i_Val) { return { _mm256_set1_epi8(static_cast<char>(i_Val)) }; }
+    void store(uint8_t * o_Dst) const { _mm256_store_si256(reinterpret_cast<__m256i *>(o_Dst), v); }
+    ByteLanes operator+(ByteLanes const & i_O) const { return { _mm256_add_epi8(v, i_O.v) }; }
+    ByteLanes operator^(ByteLanes const & i_O) const { return { _mm256_xor_si256(v, i_O.v) }; }
+    ByteLanes operator&(ByteLanes const & i_O) const { return { _mm256_and_si256(v, i_O.v) }; }
+    ByteLanes operator|(ByteLanes const & i_O) const { return { _mm256_or_si256(v, i_O.v) }; }
+    ByteLanes operator==(ByteLanes const & i_O) const { return { _mm256_cmpeq_epi8(v, i_O.v) }; }
+    uint64_t mask() const { return static_cast<uint32_t>(_mm256_movemask_epi8(v)); }
+};
+#endif
+
+#if defined(__AVX512BW__)
+template <>
+struct ByteLanes<64>
+{
+    __m512i v;
+
+    static ByteLanes load(uint8_t const * i_Src) { return { _mm512_load_si512(i_Src) }; }
+    static ByteLanes set(uint8_t i_Val) { return { _mm512_set1_epi8(static_cast<char>(i_Val)) }; }
+    void store(uint8_t * o_Dst) const { _mm512_store_si512(o_Dst, v); }
+    ByteLanes operator+(ByteLanes const & i_O) const { return { _mm512_add_epi8(v, i_O.v) }; }
+    ByteLanes operator^(ByteLanes const & i_O) const { return { _mm512_xor_si512(v, i_O.v) }; }
+    ByteLanes operator&(ByteLanes const & i_O) const { return { _mm512_and_si512(v, i_O.v) }; }
+    ByteLanes operator|(ByteLanes const & i_O) const { return { _mm512_or_si512(v, i_O.v) }; }
+    ByteLanes operator==(ByteLanes const & i_O) const { return { _mm512_movm_epi8(_mm512_cmpeq_epi8_mask(v, i_O.v)) }; }
+    uint64_t mask() const { return _mm512_movepi8_mask(v); }
+};
+#endif
+
+// Encode the W candidates of i_PW into the lanes of o_Encoded
+template <size_t N, size_t W>
+inline void encodeBatch(CandidateBatch<N, W> const & i_PW, ByteLanes<W> (&o_Encoded)[N])
+{
+    typedef ByteLanes<W> Lanes;
+
+    // Position each character comes from after swap(key), for the 4 possible keys
+    uint8_t swapSource[4][N];
+    for (auto k = 0U; k < 4; ++k)
+    {
+        for (auto i = 0U; i < N; ++i)
+        {
+            swapSource[k][i] = static_cast<uint8_t>(i);
+        }
+        for (auto i = 0U; i + k + 1 < N; ++i)
+        {
+            auto temp = swapSource[k][i];
+            swapSource[k][i] = swapSource[k][i + k + 1];
+            swapSource[k][i + k + 1] = temp;
+        }
+    }
+
+    Lanes pw[N];
+    Lanes shifted[N];
+    for (auto i = 0U; i < N; ++i)
+    {
+        pw[i] = Lanes::load(i_PW.chars[i]);
+        o_Encoded[i] = pw[i];
+    }
+
+    for (auto round = 0U; round < 3; ++round)
+    {
+        // Per-lane key minus one, and a mask of the lanes using each key
+        auto sum = Lanes::set(0);
+        for (auto i = 0U; i < N; ++i)
+        {
+            sum = sum + o_Encoded[i];
+        }
+        auto keyMinusOne = sum & Lanes::set(3);
+        Lanes hasKey[4];
+        for (auto k = 0U; k < 4; ++k)
+        {
+            hasKey[k] = keyMinusOne == Lanes::set(static_cast<uint8_t>(k));
+        }
+
+        // shift(key / 2): rotate right by 0 (key 1), 1 (keys 2 and 3) or 2 (key 4)
+        auto rotateBy1 = hasKey[1] | hasKey[2];
+        for (auto i = 0U; i < N; ++i)
+        {
+            shifted[i] = (hasKey[0] & o_Encoded[i]) |
+                         (rotateBy1 & o_Encoded[(i + N - (1 % N)) % N]) |
+                         (hasKey[3] & o_Encoded[(i + N - (2 % N)) % N]);
+        }
+
+        // add(key): character i gets key * i
+        auto key = keyMinusOne + Lanes::set(1);
+        auto offset = Lanes::set(0);
+        for (auto i = 0U; i < N; ++i)
+        {
+            shifted[i] = shifted[i] + offset;
+            offset = offset + key;
+        }
+
+        // swap(key) then xorx with the original candidate
+        for (auto i = 0U; i < N; ++i)
+        {
+            auto swapped = (hasKey[0] & shifted[swapSource[0][i]]) |
+                           (hasKey[1] & shifted[swapSource[1][i]]) |
+                           (hasKey[2] & shifted[swapSource[2][i]]) |
+                           (hasKey[3] & shifted[swapSource[3][i]]);
+            o_Encoded[i] = swapped ^ pw[i];
+        }
+    }
+}
+
+template <size_t N, size_t W>
+inline void encodeBatch(CandidateBatch<N, W> const & i_PW, CandidateBatch<N, W> & o_Encoded)
+{
+    ByteLanes<W> encoded[N];
+    encodeBatch<N, W>(i_PW, encoded);
+    for (auto i = 0U; i < N; ++i)
+    {
+        encoded[i].store(o_Encoded.chars[i]);
+    }
+}
+
+// Encode the W candidates of i_PW and return a mask with bit i set if candidate i is encoded
+// as the N characters of i_Target
+template <size_t N, size_t W>
+inline uint64_t matchBatch(CandidateBatch<N, W> const & i_PW, char const * i_Target)
+{
+    ByteLanes<W> encoded[N];
+    encodeBatch<N, W>(i_PW, encoded);
+
+    auto isSame = ByteLanes<W>::set(0xFF);
+    for (auto i = 0U; i < N; ++i)
+    {
+        isSame = isSame & (encoded[i] == ByteLanes<W>::set(static_cast<uint8_t>(i_Target[i])));
+    }
+    return isSame.mask();
+}
+
+#endif //ENCODE_BATCH_IFT630
@@ -0,0 +1,375 @@
+#include "EncodeIndex.h"
+#include "EncodeBatch.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+// Start of an index file
+struct EncodeIndexHeader
+{
+    char     magic[8];
+    uint32_t length;
+    uint32_t blockSize;
+    uint64_t numRecords;
+    uint64_t numBlocks;
+    uint64_t fencesOffset;
+};
+
+static char const INDEX_MAGIC[8] = { 'I', 'F', 'T', '6', '3', '0', 'I', '1' };
+
+// Number of messages encoded at once while building an index
+static size_t const INDEX_BATCH_WIDTH = NATIVE_BATCH_WIDTH;
+
+// Message and its encoded message (the key of the index)
+struct IndexRecord
+{
+    uint64_t key;
+    uint64_t index;
+
+    bool operator<(IndexRecord const & i_Other) const
+    {
+        return key != i_Other.key ? key < i_Other.key : index < i_Other.index;
+    }
+};
+
+static void writeVarint(uint64_t i_Value, std::vector<uint8_t> & io_Buffer)
+{
+    while (i_Value >= 0x80)
+    {
+        io_Buffer.push_back(static_cast<uint8_t>(i_Value | 0x80));
+        i_Value >>= 7;
+    }
+    io_Buffer.push_back(static_cast<uint8_t>(i_Value));
+}
+
+// Read a variable-length integer ending before i_End, return false if it is truncated
+static bool readVarint(uint8_t const * & io_Pos, uint8_t const * i_End, uint64_t & o_Value)
+{
+    o_Value = 0;
+    for (auto shift = 0U; io_Pos < i_End && shift < 64; shift += 7)
+    {
+        auto byte = *io_Pos++;
+        o_Value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Key of an encoded message: its characters read as a big-endian number, so keys and messages
+// sort the same way
+static uint64_t getKey(char const * i_Encoded, size_t i_Length)
+{
+    uint64_t key = 0;
+    for (auto i = 0U; i < i_Length; ++i)
+    {
+        key = key << 8 | static_cast<uint8_t>(i_Encoded[i]);
+    }
+    return key;
+}
+
+// Encode the messages [i_First, i_Last) of the keyspace, which all have N characters, and give
+// io_Function the key and the index (from i_First) of each one
+template <size_t N, typename Function>
+static void forEachEncoded(Keyspace const & i_Keyspace, uint64_t i_First, uint64_t i_Last, Function & io_Function)
+{
+    KeyspaceCursor cursor;
+    i_Keyspace.seek(i_First, cursor);
+    CandidateBatch<N, INDEX_BATCH_WIDTH> batch;
+    CandidateBatch<N, INDEX_BATCH_WIDTH> encoded;
+
+    for (auto index = i_First; index < i_Last; index += INDEX_BATCH_WIDTH)
+    {
+        auto batchSize = std::min<uint64_t>(INDEX_BATCH_WIDTH, i_Last - index);
+        for (auto lane = 0U; lane < INDEX_BATCH_WIDTH; ++lane)
+        {
+            for (auto i = 0U; i < N; ++i)
+            {
+                batch.chars[i][lane] = cursor.chars[i];
+            }
+            if (lane + 1 < batchSize)
+            {
+                i_Keyspace.next(cursor);
+            }
+        }
+        i_Keyspace.next(cursor);
+
+        encodeBatch<N, INDEX_BATCH_WIDTH>(batch, encoded);
+        for (auto lane = 0U; lane < batchSize; ++lane)
+        {
+            uint64_t key = 0;
+            for (auto i = 0U; i < N; ++i)
+            {
+                key = key << 8 | encoded.chars[i][lane];
+            }
+            io_Function(key, index + lane - i_First);
+        }
+    }
+}
+
+// Call forEachEncoded for messages of i_Length characters (N at most)
+template <size_t N>
+struct EncodedEnumerator
+{
+    template <typename Function>
+    static void run(size_t i_Length, Keyspace const & i_Keyspace, uint64_t i_First, uint64_t i_Last, Function & io_Function)
+    {
+        if (i_Length == N)
+        {
+            forEachEncoded<N>(i_Keyspace, i_First, i_Last, io_Function);
+        }
+        else
+        {
+            EncodedEnumerator<N - 1>::run(i_Length, i_Keyspace, i_First, i_Last, io_Function);
+        }
+    }
+};
+
+template <>
+struct EncodedEnumerator<0>
+{
+    template <typename Function>
+    static void run(size_t, Keyspace const &, uint64_t, uint64_t, Function &)
+    {
+    }
+};
+
+bool buildEncodeIndex(Keyspace const & i_Keyspace, size_t i_Length, char const * i_FileName,
+                      uint64_t i_MaxPassRecords, std::function<void(uint32_t, uint32_t)> const & i_OnPass)
+{
+    if (i_Length == 0 || i_Length > MAX_INDEX_LENGTH ||
+        i_Length < i_Keyspace.getMinLength() || i_Length > i_Keyspace.getMaxLength())
+    {
+        throw std::invalid_argument("Invalid index length " + std::to_string(i_Length));
+    }
+    auto first = i_Keyspace.getFirstIndex(i_Length);
+    auto last  = i_Keyspace.getFirstIndex(i_Length + 1);
+
+    std::unique_ptr<FILE, int (*)(FILE *)> file(fopen(i_FileName, "wb"), fclose);
+    if (!file)
+    {
+        return false;
+    }
+    setvbuf(file.get(), nullptr, _IOFBF, 1 << 20);
+
+    // Header (written again once the offsets are known) and charsets
+    EncodeIndexHeader header = {};
+    std::copy(INDEX_MAGIC, INDEX_MAGIC + sizeof(INDEX_MAGIC), header.magic);
+    header.length     = static_cast<uint32_t>(i_Length);
+    header.blockSize  = ENCODE_INDEX_BLOCK_SIZE;
+    header.numRecords = last - first;
+    header.numBlocks  = (header.numRecords + ENCODE_INDEX_BLOCK_SIZE - 1) / ENCODE_INDEX_BLOCK_SIZE;
+    std::vector<uint8_t> buffer;
+    for (auto i = 0U; i < i_Length; ++i)
+    {
+        auto const & charset = i_Keyspace.getCharset(i);
+        auto count = static_cast<uint16_t>(charset.length());
+        buffer.push_back(static_cast<uint8_t>(count));
+        buffer.push_back(static_cast<uint8_t>(count >> 8));
+        buffer.insert(buffer.end(), charset.begin(), charset.end());
+    }
+    fwrite(&header, sizeof(header), 1, file.get());
+    fwrite(buffer.data(), 1, buffer.size(), file.get());
+    auto offset = static_cast<uint64_t>(sizeof(header) + buffer.size());
+
+    // Count the keys of each bucket (the 16 high bits of the key), so that each pass sorts a range
+    // of buckets holding about i_MaxPassRecords records
+    auto const BUCKET_SHIFT = 8 * i_Length >= 16 ? 8 * i_Length - 16 : 0;
+    std::vector<uint64_t> bucketSizes(65536, 0);
+    auto countKey = [&](uint64_t i_Key, uint64_t)
+    {
+        ++bucketSizes[i_Key >> BUCKET_SHIFT];
+    };
+    EncodedEnumerator<MAX_INDEX_LENGTH>::run(i_Length, i_Keyspace, first, last, countKey);
+
+    std::vector<uint32_t> passFirstBuckets(1, 0);
+    uint64_t passSize = 0;
+    for (auto bucket = 0U; bucket < bucketSizes.size(); ++bucket)
+    {
+        if (passSize > 0 && passSize + bucketSizes[bucket] > i_MaxPassRecords)
+        {
+            passFirstBuckets.push_back(bucket);
+            passSize = 0;
+        }
+        passSize += bucketSizes[bucket];
+    }
+    passFirstBuckets.push_back(static_cast<uint32_t>(bucketSizes.size()));
+    auto numPasses = static_cast<uint32_t>(passFirstBuckets.size() - 1);
+
+    std::vector<uint64_t> fenceKeys;
+    std::vector<uint64_t> blockOffsets;
+    std::vector<IndexRecord> records;
+    uint64_t numWritten = 0;
+    uint64_t previousKey = 0;
+    for (auto pass = 0U; pass < numPasses; ++pass)
+    {
+        if (i_OnPass)
+        {
+            i_OnPass(pass, numPasses);
+        }
+
+        // Gather and sort the records of the buckets of this pass
+        auto firstBucket = passFirstBuckets[pass];
+        auto lastBucket  = passFirstBuckets[pass + 1];
+        uint64_t numRecords = 0;
+        for (auto bucket = firstBucket; bucket < lastBucket; ++bucket)
+        {
+            numRecords += bucketSizes[bucket];
+        }
+        records.clear();
+        records.reserve(numRecords);
+        auto keepRecord = [&](uint64_t i_Key, uint64_t i_Index)
+        {
+            auto bucket = i_Key >> BUCKET_SHIFT;
+            if (bucket >= firstBucket && bucket < lastBucket)
+            {
+                IndexRecord record = { i_Key, i_Index };
+                records.push_back(record);
+            }
+        };
+        EncodedEnumerator<MAX_INDEX_LENGTH>::run(i_Length, i_Keyspace, first, last, keepRecord);
+        std::sort(records.begin(), records.end());
+
+        // Append them to the blocks
+        buffer.clear();
+        for (auto const & record : records)
+        {
+            if (numWritten % ENCODE_INDEX_BLOCK_SIZE == 0)
+            {
+                fenceKeys.push_back(record.key);
+                blockOffsets.push_back(offset + buffer.size());
+                previousKey = record.key;
+            }
+            writeVarint(record.key - previousKey, buffer);
+            writeVarint(record.index, buffer);
+            previousKey = record.key;
+            ++numWritten;
+        }
+        fwrite(buffer.data(), 1, buffer.size(), file.get());
+        offset += buffer.size();
+    }
+
+    // Fences, then the final header
+    header.fencesOffset = offset;
+    fwrite(fenceKeys.data(), sizeof(uint64_t), fenceKeys.size(), file.get());
+    fwrite(blockOffsets.data(), sizeof(uint64_t), blockOffsets.size(), file.get());
+    fseek(file.get(), 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file.get());
+    return !ferror(file.get()) && fflush(file.get()) == 0;
+}
+
+EncodeIndex::EncodeIndex()
+: m_length(0)
+, m_numRecords(0)
+, m_blockOffsets(nullptr)
+{
+}
+
+bool EncodeIndex::open(char const * i_FileName)
+{
+    m_charsets.clear();
+    m_fenceKeys.clear();
+    if (!m_file.open(i_FileName, false) || m_file.size() < sizeof(EncodeIndexHeader))
+    {
+        return false;
+    }
+
+    EncodeIndexHeader header;
+    memcpy(&header, m_file.data(), sizeof(header));
+    if (!std::equal(INDEX_MAGIC, INDEX_MAGIC + sizeof(INDEX_MAGIC), header.magic) ||
+        header.length == 0 || header.length > MAX_INDEX_LENGTH || header.blockSize != ENCODE_INDEX_BLOCK_SIZE ||
+        header.fencesOffset > m_file.size() || (m_file.size() - header.fencesOffset) / 16 < header.numBlocks)
+    {
+        m_file.close();
+        return false;
+    }
+    m_length = header.length;
+    m_numRecords = header.numRecords;
+
+    // Charsets follow the header
+    auto pos = sizeof(header);
+    for (auto i = 0U; i < m_length; ++i)
+    {
+        if (pos + 2 > header.fencesOffset)
+        {
+            m_file.close();
+            return false;
+        }
+        auto count = static_cast<uint8_t>(m_file.data()[pos]) | static_cast<uint8_t>(m_file.data()[pos + 1]) << 8;
+        pos += 2;
+        if (count == 0 || pos + count > header.fencesOffset)
+        {
+            m_file.close();
+            return false;
+        }
+        m_charsets.push_back(std::string(m_file.data() + pos, count));
+        pos += count;
+    }
+
+    // Keep the fence keys in memory, block offsets are read from the file
+    m_fenceKeys.resize(static_cast<size_t>(header.numBlocks));
+    memcpy(m_fenceKeys.data(), m_file.data() + header.fencesOffset, m_fenceKeys.size() * sizeof(uint64_t));
+    m_blockOffsets = m_file.data() + header.fencesOffset + m_fenceKeys.size() * sizeof(uint64_t);
+    return true;
+}
+
+std::vector<std::string> EncodeIndex::find(std::string const & i_Encoded) const
+{
+    std::vector<std::string> messages;
+    if (i_Encoded.length() != m_length || m_fenceKeys.empty())
+    {
+        return messages;
+    }
+    auto key = getKey(i_Encoded.data(), i_Encoded.length());
+
+    // Records of the key start in the last block whose fence is less than the key (or in the first
+    // block whose fence is the key) and may go on in the next blocks
+    auto block = static_cast<size_t>(std::lower_bound(m_fenceKeys.begin(), m_fenceKeys.end(), key) - m_fenceKeys.begin());
+    block = block > 0 ? block - 1 : 0;
+    auto end = reinterpret_cast<uint8_t const *>(m_file.data()) + m_file.size();
+    for (; block < m_fenceKeys.size() && m_fenceKeys[block] <= key; ++block)
+    {
+        uint64_t offset;
+        memcpy(&offset, m_blockOffsets + block * sizeof(uint64_t), sizeof(offset));
+        auto pos = reinterpret_cast<uint8_t const *>(m_file.data()) + std::min<uint64_t>(offset, m_file.size());
+        auto numRecords = std::min<uint64_t>(ENCODE_INDEX_BLOCK_SIZE, m_numRecords - block * ENCODE_INDEX_BLOCK_SIZE);
+
+        auto recordKey = m_fenceKeys[block];
+        for (auto i = 0U; i < numRecords; ++i)
+        {
+            uint64_t delta;
+            uint64_t index;
+            if (!readVarint(pos, end, delta) || !readVarint(pos, end, index))
+            {
+                return messages;
+            }
+            recordKey += delta;
+            if (recordKey > key)
+            {
+                return messages;
+            }
+            if (recordKey == key)
+            {
+                messages.push_back(getMessage(index));
+            }
+        }
+    }
+    return messages;
+}
+
+std::string EncodeIndex::getMessage(uint64_t i_Index) const
+{
+    // Messages are numbered in mixed radix, the last position varying fastest
+    std::string message(m_length, 0);
+    for (auto i = m_length; i-- > 0;)
+    {
+        auto radix = m_charsets[i].length();
+        message[i] = m_charsets[i][i_Index % radix];
+        i_Index /= radix;
+    }
+    return message;
+}
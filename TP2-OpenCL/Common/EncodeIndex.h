@@ -0,0 +1,66 @@
+#ifndef ENCODE_INDEX_IFT630
+#define ENCODE_INDEX_IFT630
+
+#include "Keyspace.h"
+#include "MappedFile.h"
+#include <functional>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Longest message an index can hold (encoded messages are used as 64-bit keys)
+size_t const MAX_INDEX_LENGTH = 8;
+
+// Number of records per block of an index file
+uint32_t const ENCODE_INDEX_BLOCK_SIZE = 256;
+
+// Precomputed encode() of every message of one length of a keyspace, stored on disk sorted by
+// encoded message, so recovering the messages of an encoded message is a lookup instead of a
+// search.
+//
+// File layout (little-endian):
+//  - header, then the charset of each position (so messages can be rebuilt from their index)
+//  - blocks of ENCODE_INDEX_BLOCK_SIZE records sorted by key (the encoded message read as a
+//    big-endian number). A record is the difference with the previous key and the index of the
+//    message in the keyspace, both as variable-length integers (LEB128), so a record of a 6
+//    character index takes about 7 bytes instead of 14.
+//  - fences: the first key of every block, then the offset of every block
+//
+// Fence keys are loaded in memory (8 bytes per block); a lookup is a binary search in them and the
+// decoding of one block (rarely two) read from the mapped file.
+class EncodeIndex
+{
+public:
+    EncodeIndex();
+
+    // Map an index file, return false if it cannot be read or is not an index
+    bool open(char const * i_FileName);
+
+    size_t getLength() const { return m_length; }
+    uint64_t size() const { return m_numRecords; }
+
+    // Messages whose encoded message is i_Encoded (several messages can share one), in increasing
+    // keyspace order
+    std::vector<std::string> find(std::string const & i_Encoded) const;
+
+private:
+    std::string getMessage(uint64_t i_Index) const;
+
+    MappedFile               m_file;
+    size_t                   m_length;
+    uint64_t                 m_numRecords;
+    std::vector<std::string> m_charsets;
+    std::vector<uint64_t>    m_fenceKeys;
+    char const *             m_blockOffsets;
+};
+
+// Write the index of the messages of i_Length characters of i_Keyspace in i_FileName. Records are
+// sorted by passes over the keyspace holding at most about i_MaxPassRecords records in memory
+// (16 bytes each); i_OnPass is called before each pass if not null. Return false if the file
+// cannot be written. Throws std::invalid_argument if i_Length is not a length of the keyspace or is
+// more than MAX_INDEX_LENGTH.
+bool buildEncodeIndex(Keyspace const & i_Keyspace, size_t i_Length, char const * i_FileName,
+                      uint64_t i_MaxPassRecords = 1 << 24,
+                      std::function<void(uint32_t i_Pass, uint32_t i_NumPasses)> const & i_OnPass = nullptr);
+
+#endif //ENCODE_INDEX_IFT630
@@ -0,0 +1,291 @@
+#include "InverseSolver.h"
+#include "Encode.h"
+#include <algorithm>
+
+namespace
+{
+
+// Tables of one round of encode() for a given key
+struct Round
+{
+    std::vector<uint8_t> source;
+    std::vector<uint8_t> offset;
+    std::vector<uint8_t> inverse;
+};
+
+// Search of the messages matching one key schedule
+class ScheduleSolver
+{
+public:
+    ScheduleSolver(std::string const & i_Encoded, std::string const & i_Charset,
+                   Round const & i_Round1, Round const & i_Round2, Round const & i_Round3,
+                   std::vector<std::string> & o_Solutions)
+    : m_encoded(i_Encoded)
+    , m_charset(i_Charset)
+    , m_round1(i_Round1)
+    , m_round2(i_Round2)
+    , m_round3(i_Round3)
+    , m_solutions(o_Solutions)
+    , m_length(i_Encoded.length())
+    , m_message(m_length, 0)
+    , m_isInCharset(256, false)
+    {
+        for (auto c : m_charset)
+        {
+            m_isInCharset[static_cast<uint8_t>(c)] = true;
+        }
+        orderPositions();
+    }
+
+    void solve()
+    {
+        assign(0);
+    }
+
+private:
+    // Characters of the message involved in the equation of position i
+    void getEquationPositions(size_t i_Pos, size_t * o_Positions) const
+    {
+        auto p2 = m_round2.inverse[i_Pos];
+        o_Positions[0] = m_round1.source[i_Pos];
+        o_Positions[1] = i_Pos;
+        o_Positions[2] = p2;
+        o_Positions[3] = m_round3.inverse[p2];
+    }
+
+    // Walk the target back to the message: the first round reads message[source1[i]], which must
+    // be what the second round output at i gives once its xor and addition are undone
+    bool checkEquation(size_t i_Pos) const
+    {
+        auto p2 = m_round2.inverse[i_Pos];
+        auto p3 = m_round3.inverse[p2];
+        auto out2 = static_cast<uint8_t>((m_encoded[p3] ^ m_message[p3]) - m_round3.offset[p3]);
+        auto out1 = static_cast<uint8_t>((out2 ^ static_cast<uint8_t>(m_message[p2])) - m_round2.offset[p2]);
+        auto in   = static_cast<uint8_t>((out1 ^ static_cast<uint8_t>(m_message[i_Pos])) - m_round1.offset[i_Pos]);
+        return in == static_cast<uint8_t>(m_message[m_round1.source[i_Pos]]);
+    }
+
+    // Every character appears once in its equation through invertible operations (xor and
+    // addition of known values), so the last unknown character of an equation can be computed
+    // directly. Return false if i_Pos appears more than once in the equation of position i_Eq.
+    bool solveFor(size_t i_Eq, size_t i_Pos, char & o_Value) const
+    {
+        size_t positions[4];
+        getEquationPositions(i_Eq, positions);
+        if (std::count(positions, positions + 4, i_Pos) != 1)
+        {
+            return false;
+        }
+
+        auto p2 = positions[2];
+        auto p3 = positions[3];
+
+        // Walk forward from the target as far as the known characters allow
+        auto out2 = static_cast<uint8_t>((m_encoded[p3] ^ m_message[p3]) - m_round3.offset[p3]);
+        auto out1 = static_cast<uint8_t>((out2 ^ static_cast<uint8_t>(m_message[p2])) - m_round2.offset[p2]);
+        auto in   = static_cast<uint8_t>((out1 ^ static_cast<uint8_t>(m_message[i_Eq])) - m_round1.offset[i_Eq]);
+        if (i_Pos == positions[0])
+        {
+            o_Value = static_cast<char>(in);
+            return true;
+        }
+
+        // Walk back from the message character read by the first round: each step gives the value
+        // a round output xored with its message character must have before the offset is added
+        auto mixed1 = static_cast<uint8_t>(static_cast<uint8_t>(m_message[positions[0]]) + m_round1.offset[i_Eq]);
+        if (i_Pos == i_Eq)
+        {
+            o_Value = static_cast<char>(mixed1 ^ out1);
+            return true;
+        }
+        auto mixed2 = static_cast<uint8_t>((mixed1 ^ static_cast<uint8_t>(m_message[i_Eq])) + m_round2.offset[p2]);
+        if (i_Pos == p2)
+        {
+            o_Value = static_cast<char>(mixed2 ^ out2);
+            return true;
+        }
+        auto mixed3 = static_cast<uint8_t>((mixed2 ^ static_cast<uint8_t>(m_message[p2])) + m_round3.offset[p3]);
+        o_Value = static_cast<char>(mixed3 ^ static_cast<uint8_t>(m_encoded[p3]));
+        return true;
+    }
+
+    // Pick the order in which positions are assigned so that equations complete as early as possible
+    void orderPositions()
+    {
+        std::vector<bool> isAssigned(m_length, false);
+        std::vector<bool> isChecked(m_length, false);
+        m_checksPerLevel.resize(m_length);
+
+        for (auto level = 0U; level < m_length; ++level)
+        {
+            auto bestPos = m_length;
+            auto bestScore = -1;
+            for (auto pos = 0U; pos < m_length; ++pos)
+            {
+                if (isAssigned[pos])
+                {
+                    continue;
+                }
+
+                // Score: equations completed by this position first, then equations it appears in
+                auto score = 0;
+                for (auto eq = 0U; eq < m_length; ++eq)
+                {
+                    size_t positions[4];
+                    getEquationPositions(eq, positions);
+                    auto involvesPos = false;
+                    auto isComplete = true;
+                    for (auto p : positions)
+                    {
+                        involvesPos |= p == pos;
+                        isComplete &= p == pos || isAssigned[p];
+                    }
+                    score += involvesPos ? (isComplete ? m_length + 1 : 1) : 0;
+                }
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestPos = pos;
+                }
+            }
+
+            m_order.push_back(bestPos);
+            isAssigned[bestPos] = true;
+
+            // Equations that can be checked once this position is assigned
+            for (auto eq = 0U; eq < m_length; ++eq)
+            {
+                size_t positions[4];
+                getEquationPositions(eq, positions);
+                auto isComplete = true;
+                for (auto p : positions)
+                {
+                    isComplete &= isAssigned[p];
+                }
+                if (isComplete && !isChecked[eq])
+                {
+                    isChecked[eq] = true;
+                    m_checksPerLevel[level].push_back(eq);
+                }
+            }
+        }
+    }
+
+    void assign(size_t i_Level)
+    {
+        if (i_Level == m_length)
+        {
+            // Equations only hold if the keys of the message are the ones of this schedule
+            if (encode(m_message) == m_encoded)
+            {
+                m_solutions.push_back(m_message);
+            }
+            return;
+        }
+
+        // If an equation completed by this position can be solved for it, only one character fits
+        auto pos = m_order[i_Level];
+        auto const * candidates = &m_charset;
+        std::string forced;
+        for (auto eq : m_checksPerLevel[i_Level])
+        {
+            char value;
+            if (solveFor(eq, pos, value))
+            {
+                if (!m_isInCharset[static_cast<uint8_t>(value)])
+                {
+                    return;
+                }
+                forced.assign(1, value);
+                candidates = &forced;
+                break;
+            }
+        }
+
+        for (auto c : *candidates)
+        {
+            m_message[pos] = c;
+
+            auto isValid = true;
+            for (auto eq : m_checksPerLevel[i_Level])
+            {
+                if (!checkEquation(eq))
+                {
+                    isValid = false;
+                    break;
+                }
+            }
+            if (isValid)
+            {
+                assign(i_Level + 1);
+            }
+        }
+    }
+
+    ScheduleSolver(ScheduleSolver const &);
+    ScheduleSolver & operator=(ScheduleSolver const &);
+
+    std::string const &        m_encoded;
+    std::string const &        m_charset;
+    Round const &              m_round1;
+    Round const &              m_round2;
+    Round const &              m_round3;
+    std::vector<std::string> & m_solutions;
+    size_t                     m_length;
+    std::string                m_message;
+    std::vector<bool>          m_isInCharset;
+    std::vector<size_t>        m_order;
+    std::vector<std::vector<size_t>> m_checksPerLevel;
+};
+
+}
+
+std::vector<std::string> solveEncoded(std::string const & i_Encoded, std::string const & i_Charset)
+{
+    std::vector<std::string> solutions;
+    auto length = i_Encoded.length();
+
+    // Too short for the rounds to be described by permutations: just try every character
+    if (length < 2)
+    {
+        for (auto c : i_Charset)
+        {
+            if (length == 1 && encode(std::string(1, c)) == i_Encoded)
+            {
+                solutions.push_back(std::string(1, c));
+            }
+        }
+        return solutions;
+    }
+
+    // Tables of a round for each key
+    Round rounds[4];
+    for (auto k = 0U; k < 4; ++k)
+    {
+        rounds[k].source.resize(length);
+        rounds[k].offset.resize(length);
+        rounds[k].inverse.resize(length);
+        getRoundTables(length, static_cast<uint8_t>(k + 1), rounds[k].source.data(), rounds[k].offset.data());
+        for (auto i = 0U; i < length; ++i)
+        {
+            rounds[k].inverse[rounds[k].source[i]] = static_cast<uint8_t>(i);
+        }
+    }
+
+    // Try each of the 64 key schedules (keys giving identical rounds on short messages find the
+    // same messages, hence the removal of duplicates)
+    for (auto k1 = 0U; k1 < 4; ++k1)
+    {
+        for (auto k2 = 0U; k2 < 4; ++k2)
+        {
+            for (auto k3 = 0U; k3 < 4; ++k3)
+            {
+                ScheduleSolver(i_Encoded, i_Charset, rounds[k1], rounds[k2], rounds[k3], solutions).solve();
+            }
+        }
+    }
+
+    std::sort(solutions.begin(), solutions.end());
+    solutions.erase(std::unique(solutions.begin(), solutions.end()), solutions.end());
+    return solutions;
+}
@@ -0,0 +1,19 @@
+#ifndef INVERSE_SOLVER_IFT630
+#define INVERSE_SOLVER_IFT630
+
+#include <string>
+#include <vector>
+
+// Find every message made of characters of i_Charset that encode() turns into i_Encoded.
+//
+// Instead of enumerating every message, the solver enumerates the 64 possible key schedules
+// (one key from 1 to 4 per round). Once the keys are fixed, each round is a fixed permutation,
+// addition and xor, so the target can be walked back: every position of the message must satisfy
+// one equation involving at most 4 of its characters. Characters are chosen one position at a
+// time: a position that is the last unknown of an equation gets the only character solving it,
+// the others are enumerated, and a partial message is dropped as soon as one of its complete
+// equations fails. Every message found is checked with encode().
+std::vector<std::string> solveEncoded(std::string const & i_Encoded,
+                                      std::string const & i_Charset = "abcdefghijklmnopqrstuvwxyz");
+
+#endif //INVERSE_SOLVER_IFT630
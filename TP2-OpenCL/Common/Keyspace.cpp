@@ -0,0 +1,172 @@
+#include "Keyspace.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+// Charsets of the mask placeholders
+static char const LOWERCASE[] = "abcdefghijklmnopqrstuvwxyz";
+static char const UPPERCASE[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+static char const DIGITS[]    = "0123456789";
+static char const SYMBOLS[]   = " !\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~";
+
+Keyspace::Keyspace(std::string const & i_Mask, size_t i_MinLength, std::vector<std::string> const & i_CustomCharsets)
+{
+    // Charset of each position of the mask
+    for (auto i = 0U; i < i_Mask.length(); ++i)
+    {
+        if (i_Mask[i] != '?')
+        {
+            m_charsets.push_back(std::string(1, i_Mask[i]));
+            continue;
+        }
+        if (++i == i_Mask.length())
+        {
+            throw std::invalid_argument("Mask ends with an incomplete placeholder");
+        }
+
+        switch (i_Mask[i])
+        {
+        case 'l': m_charsets.push_back(LOWERCASE); break;
+        case 'u': m_charsets.push_back(UPPERCASE); break;
+        case 'd': m_charsets.push_back(DIGITS);    break;
+        case 's': m_charsets.push_back(SYMBOLS);   break;
+        case 'a': m_charsets.push_back(std::string(LOWERCASE) + UPPERCASE + DIGITS + SYMBOLS); break;
+        case '?': m_charsets.push_back("?"); break;
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        {
+            auto custom = static_cast<size_t>(i_Mask[i] - '1');
+            if (custom >= i_CustomCharsets.size() || i_CustomCharsets[custom].empty())
+            {
+                throw std::invalid_argument(std::string("Custom charset ?") + i_Mask[i] + " is not defined");
+            }
+            m_charsets.push_back(i_CustomCharsets[custom]);
+            break;
+        }
+        default:
+            throw std::invalid_argument(std::string("Unknown placeholder ?") + i_Mask[i]);
+        }
+
+        // Digits of a cursor are bytes
+        if (m_charsets.back().length() > 256)
+        {
+            throw std::invalid_argument("Charsets cannot have more than 256 characters");
+        }
+    }
+
+    if (m_charsets.empty() || m_charsets.size() > MAX_KEYSPACE_LENGTH)
+    {
+        throw std::invalid_argument("Mask must describe 1 to " + std::to_string(MAX_KEYSPACE_LENGTH) + " characters");
+    }
+    m_minLength = i_MinLength == 0 ? m_charsets.size() : i_MinLength;
+    if (m_minLength > m_charsets.size())
+    {
+        throw std::invalid_argument("Minimum length is longer than the mask");
+    }
+
+    // Index of the first candidate of each length, from the minimum length to one past the maximum
+    m_firstIndex.push_back(0);
+    for (auto length = m_minLength; length <= m_charsets.size(); ++length)
+    {
+        auto count = 1ULL;
+        for (auto i = 0U; i < length; ++i)
+        {
+            if (count > std::numeric_limits<uint64_t>::max() / m_charsets[i].length())
+            {
+                throw std::invalid_argument("Keyspace has more than 2^64 candidates");
+            }
+            count *= m_charsets[i].length();
+        }
+        if (m_firstIndex.back() > std::numeric_limits<uint64_t>::max() - count)
+        {
+            throw std::invalid_argument("Keyspace has more than 2^64 candidates");
+        }
+        m_firstIndex.push_back(m_firstIndex.back() + count);
+    }
+}
+
+uint64_t Keyspace::getFirstIndex(size_t i_Length) const
+{
+    if (i_Length <= m_minLength)
+    {
+        return 0;
+    }
+    if (i_Length > m_charsets.size())
+    {
+        return getSize();
+    }
+    return m_firstIndex[i_Length - m_minLength];
+}
+
+size_t Keyspace::getLength(uint64_t i_Index) const
+{
+    auto length = m_minLength;
+    while (i_Index >= getFirstIndex(length + 1) && length < m_charsets.size())
+    {
+        ++length;
+    }
+    return length;
+}
+
+void Keyspace::getRange(uint64_t i_Part, uint64_t i_NumParts, uint64_t & o_First, uint64_t & o_Last) const
+{
+    // The first (size % parts) parts get one more candidate
+    auto perPart   = getSize() / i_NumParts;
+    auto remainder = getSize() % i_NumParts;
+    o_First = i_Part * perPart + std::min(i_Part, remainder);
+    o_Last  = o_First + perPart + (i_Part < remainder ? 1 : 0);
+}
+
+void Keyspace::seek(uint64_t i_Index, KeyspaceCursor & o_Cursor) const
+{
+    // Write the index within its length in mixed radix, last position first
+    auto length = getLength(i_Index);
+    auto index = i_Index - getFirstIndex(length);
+    for (auto i = length; i-- > 0;)
+    {
+        auto radix = m_charsets[i].length();
+        o_Cursor.digits[i] = static_cast<uint8_t>(index % radix);
+        o_Cursor.chars[i]  = m_charsets[i][index % radix];
+        index /= radix;
+    }
+    o_Cursor.chars[length] = 0;
+    o_Cursor.length = length;
+    o_Cursor.index  = i_Index;
+}
+
+bool Keyspace::next(KeyspaceCursor & io_Cursor) const
+{
+    if (io_Cursor.index + 1 >= getSize())
+    {
+        return false;
+    }
+    ++io_Cursor.index;
+
+    // Increment the last digit and carry
+    for (auto i = io_Cursor.length; i-- > 0;)
+    {
+        if (io_Cursor.digits[i] + 1U < m_charsets[i].length())
+        {
+            io_Cursor.chars[i] = m_charsets[i][++io_Cursor.digits[i]];
+            return true;
+        }
+        io_Cursor.digits[i] = 0;
+        io_Cursor.chars[i]  = m_charsets[i][0];
+    }
+
+    // Every candidate of this length was enumerated: go to the first one of the next length
+    auto length = io_Cursor.length++;
+    io_Cursor.digits[length] = 0;
+    io_Cursor.chars[length]  = m_charsets[length][0];
+    io_Cursor.chars[length + 1] = 0;
+    return true;
+}
+
+std::string Keyspace::getCandidate(uint64_t i_Index) const
+{
+    KeyspaceCursor cursor;
+    seek(i_Index, cursor);
+    return std::string(cursor.chars, cursor.length);
+}
@@ -0,0 +1,73 @@
+#ifndef KEYSPACE_IFT630
+#define KEYSPACE_IFT630
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Longest candidate a keyspace can describe
+size_t const MAX_KEYSPACE_LENGTH = 32;
+
+// Position in a keyspace: the candidate and the index of each of its characters in the charset
+// of its position (the digits of the candidate index in mixed radix)
+struct KeyspaceCursor
+{
+    uint64_t index;
+    size_t   length;
+    uint8_t  digits[MAX_KEYSPACE_LENGTH];
+    char     chars[MAX_KEYSPACE_LENGTH + 1];
+};
+
+// Set of candidates described by a mask: one charset per position, and a range of lengths (a
+// candidate of length L uses the first L positions of the mask).
+//
+// Candidates are numbered from 0 to getSize() - 1, shortest first, then in mixed radix with the
+// last position varying fastest. Any index can be turned into its candidate, so the keyspace can
+// be split in exact index ranges between threads, processes or devices, and a range is then
+// enumerated incrementally with next().
+class Keyspace
+{
+public:
+    // Mask syntax: ?l (lowercase), ?u (uppercase), ?d (digits), ?s (symbols), ?a (all of them),
+    // ?1 to ?4 (i_CustomCharsets[0] to [3]), ?? (a question mark), or any other character (only
+    // this character). Lengths go from i_MinLength (0 means the length of the mask) to the length
+    // of the mask. Throws std::invalid_argument if the mask is invalid or the keyspace does not
+    // fit in 64 bits.
+    explicit Keyspace(std::string const & i_Mask, size_t i_MinLength = 0,
+                      std::vector<std::string> const & i_CustomCharsets = std::vector<std::string>());
+
+    size_t getMinLength() const { return m_minLength; }
+    size_t getMaxLength() const { return m_charsets.size(); }
+
+    // Characters possible at position i_Pos
+    std::string const & getCharset(size_t i_Pos) const { return m_charsets[i_Pos]; }
+
+    // Number of candidates of every length
+    uint64_t getSize() const { return m_firstIndex.back(); }
+
+    // Index of the first candidate of length i_Length (the candidates of this length end at the
+    // first index of length i_Length + 1)
+    uint64_t getFirstIndex(size_t i_Length) const;
+
+    // Length of the candidate of index i_Index
+    size_t getLength(uint64_t i_Index) const;
+
+    // Bounds [o_First, o_Last) of part i_Part when the keyspace is split in i_NumParts parts that
+    // differ by at most one candidate
+    void getRange(uint64_t i_Part, uint64_t i_NumParts, uint64_t & o_First, uint64_t & o_Last) const;
+
+    // Move the cursor to the candidate of index i_Index (less than getSize())
+    void seek(uint64_t i_Index, KeyspaceCursor & o_Cursor) const;
+
+    // Move the cursor to the next candidate. Return false if it was the last one.
+    bool next(KeyspaceCursor & io_Cursor) const;
+
+    std::string getCandidate(uint64_t i_Index) const;
+
+private:
+    std::vector<std::string> m_charsets;
+    size_t                   m_minLength;
+    std::vector<uint64_t>    m_firstIndex;
+};
+
+#endif //KEYSPACE_IFT630
@@ -0,0 +1,136 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile()
+: m_data(nullptr)
+, m_size(0)
+, m_file(INVALID_HANDLE_VALUE)
+, m_mapping(nullptr)
+{
+}
+
+bool MappedFile::open(char const * i_FileName, bool i_IsSequential)
+{
+    close();
+
+    m_file = CreateFileA(i_FileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                         i_IsSequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, nullptr);
+    LARGE_INTEGER size;
+    if (m_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_file, &size))
+    {
+        close();
+        return false;
+    }
+    m_size = static_cast<size_t>(size.QuadPart);
+
+    // Empty files cannot be mapped
+    if (m_size == 0)
+    {
+        return true;
+    }
+
+    m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping != nullptr)
+    {
+        m_data = static_cast<char const *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (m_data == nullptr)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (m_data != nullptr)
+    {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping != nullptr)
+    {
+        CloseHandle(m_mapping);
+    }
+    if (m_file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_file);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_file = INVALID_HANDLE_VALUE;
+    m_mapping = nullptr;
+}
+
+#else
+
+MappedFile::MappedFile()
+: m_data(nullptr)
+, m_size(0)
+, m_file(-1)
+{
+}
+
+bool MappedFile::open(char const * i_FileName, bool i_IsSequential)
+{
+    close();
+
+    m_file = ::open(i_FileName, O_RDONLY);
+    struct stat status;
+    if (m_file < 0 || fstat(m_file, &status) != 0)
+    {
+        close();
+        return false;
+    }
+    m_size = static_cast<size_t>(status.st_size);
+
+    // Empty files cannot be mapped
+    if (m_size == 0)
+    {
+        return true;
+    }
+
+    auto data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+    if (data == MAP_FAILED)
+    {
+        close();
+        return false;
+    }
+    m_data = static_cast<char const *>(data);
+
+    // Let the OS read ahead only if the file is read from start to end
+    madvise(data, m_size, i_IsSequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (m_data != nullptr)
+    {
+        munmap(const_cast<char *>(m_data), m_size);
+    }
+    if (m_file >= 0)
+    {
+        ::close(m_file);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_file = -1;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
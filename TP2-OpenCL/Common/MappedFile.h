@@ -0,0 +1,36 @@
+#ifndef MAPPED_FILE_IFT630
+#define MAPPED_FILE_IFT630
+
+#include <stddef.h>
+
+// Read-only view of a whole file mapped in memory. Pages are loaded by the OS when first read, so
+// files larger than the memory can be streamed through without copies.
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    // Map the file, return false if it cannot be opened or mapped. i_IsSequential tells the OS
+    // whether the file is read from start to end (read ahead) or at random places (no read ahead).
+    bool open(char const * i_FileName, bool i_IsSequential = true);
+    void close();
+
+    char const * data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    MappedFile(MappedFile const &);
+    MappedFile & operator=(MappedFile const &);
+
+    char const * m_data;
+    size_t       m_size;
+#ifdef _WIN32
+    void *       m_file;
+    void *       m_mapping;
+#else
+    int          m_file;
+#endif
+};
+
+#endif //MAPPED_FILE_IFT630
@@ -0,0 +1,166 @@
+#include "Rules.h"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+static bool isLower(char i_Char) { return i_Char >= 'a' && i_Char <= 'z'; }
+static bool isUpper(char i_Char) { return i_Char >= 'A' && i_Char <= 'Z'; }
+
+static char toggleCase(char i_Char)
+{
+    return isLower(i_Char) || isUpper(i_Char) ? static_cast<char>(i_Char ^ 0x20) : i_Char;
+}
+
+// Position written as 0 to 9 then A to Z
+static uint8_t parsePosition(char i_Char)
+{
+    if (i_Char >= '0' && i_Char <= '9')
+    {
+        return static_cast<uint8_t>(i_Char - '0');
+    }
+    if (i_Char >= 'A' && i_Char <= 'Z')
+    {
+        return static_cast<uint8_t>(i_Char - 'A' + 10);
+    }
+    throw std::invalid_argument(std::string("Invalid position ") + i_Char);
+}
+
+Rule::Rule(std::string const & i_Text)
+{
+    for (auto i = 0U; i < i_Text.length(); ++i)
+    {
+        Operation operation = { i_Text[i], 0, 0 };
+
+        // Number of characters following the operation
+        size_t numArgs;
+        switch (operation.type)
+        {
+        case ' ':
+            continue;
+        case ':': case 'l': case 'u': case 'c': case 't': case 'r': case 'd':
+            numArgs = 0;
+            break;
+        case 'T': case '$': case '^': case '@':
+            numArgs = 1;
+            break;
+        case 's':
+            numArgs = 2;
+            break;
+        default:
+            throw std::invalid_argument(std::string("Unknown rule operation ") + operation.type);
+        }
+
+        if (i + numArgs >= i_Text.length())
+        {
+            throw std::invalid_argument(std::string("Missing argument of rule operation ") + operation.type);
+        }
+        if (numArgs > 0)
+        {
+            operation.arg1 = operation.type == 'T' ? parsePosition(i_Text[i + 1]) : static_cast<uint8_t>(i_Text[i + 1]);
+        }
+        if (numArgs > 1)
+        {
+            operation.arg2 = static_cast<uint8_t>(i_Text[i + 2]);
+        }
+        i += numArgs;
+
+        if (operation.type != ':')
+        {
+            m_operations.push_back(operation);
+        }
+    }
+}
+
+size_t Rule::apply(char const * i_Word, size_t i_Length, char * o_Word) const
+{
+    if (i_Length > MAX_RULE_OUTPUT)
+    {
+        return 0;
+    }
+    std::copy(i_Word, i_Word + i_Length, o_Word);
+    auto length = i_Length;
+
+    for (auto const & operation : m_operations)
+    {
+        switch (operation.type)
+        {
+        case 'l':
+            std::transform(o_Word, o_Word + length, o_Word, [](char c) { return isUpper(c) ? static_cast<char>(c ^ 0x20) : c; });
+            break;
+        case 'u':
+            std::transform(o_Word, o_Word + length, o_Word, [](char c) { return isLower(c) ? static_cast<char>(c ^ 0x20) : c; });
+            break;
+        case 'c':
+            std::transform(o_Word, o_Word + length, o_Word, [](char c) { return isUpper(c) ? static_cast<char>(c ^ 0x20) : c; });
+            if (length > 0 && isLower(o_Word[0]))
+            {
+                o_Word[0] ^= 0x20;
+            }
+            break;
+        case 't':
+            std::transform(o_Word, o_Word + length, o_Word, toggleCase);
+            break;
+        case 'T':
+            if (operation.arg1 < length)
+            {
+                o_Word[operation.arg1] = toggleCase(o_Word[operation.arg1]);
+            }
+            break;
+        case 'r':
+            std::reverse(o_Word, o_Word + length);
+            break;
+        case 'd':
+            if (2 * length > MAX_RULE_OUTPUT)
+            {
+                return 0;
+            }
+            std::copy(o_Word, o_Word + length, o_Word + length);
+            length *= 2;
+            break;
+        case '$':
+            if (length == MAX_RULE_OUTPUT)
+            {
+                return 0;
+            }
+            o_Word[length++] = static_cast<char>(operation.arg1);
+            break;
+        case '^':
+            if (length == MAX_RULE_OUTPUT)
+            {
+                return 0;
+            }
+            std::copy_backward(o_Word, o_Word + length, o_Word + length + 1);
+            o_Word[0] = static_cast<char>(operation.arg1);
+            ++length;
+            break;
+        case 's':
+            std::replace(o_Word, o_Word + length, static_cast<char>(operation.arg1), static_cast<char>(operation.arg2));
+            break;
+        case '@':
+            length = std::remove(o_Word, o_Word + length, static_cast<char>(operation.arg1)) - o_Word;
+            break;
+        }
+    }
+    return length;
+}
+
+std::vector<Rule> loadRules(char const * i_FileName)
+{
+    std::ifstream file(i_FileName);
+    if (!file)
+    {
+        throw std::invalid_argument(std::string("Cannot read ") + i_FileName);
+    }
+
+    std::vector<Rule> rules;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        line.erase(line.find_last_not_of("\r") + 1);
+        if (!line.empty() && line[0] != '#')
+        {
+            rules.push_back(Rule(line));
+        }
+    }
+    return rules;
+}
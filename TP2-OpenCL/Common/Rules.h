@@ -0,0 +1,47 @@
+#ifndef RULES_IFT630
+#define RULES_IFT630
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Longest word a rule can produce
+size_t const MAX_RULE_OUTPUT = 64;
+
+// Mangling rule applied to the words of a wordlist, compiled once from a subset of the usual
+// rule syntax. A rule is a sequence of operations applied from left to right, N being a
+// position (0 to 9, then A to Z for 10 to 35):
+//  :    keep the word as is           r    reverse
+//  l    lowercase                     d    duplicate
+//  u    uppercase                     $X   append X
+//  c    capitalize                    ^X   prepend X
+//  t    toggle the case of all        sXY  replace every X by Y (leetspeak)
+//  TN   toggle the case at N          @X   remove every X
+// Spaces between operations are ignored.
+class Rule
+{
+public:
+    // Throws std::invalid_argument if i_Text is not a valid rule
+    explicit Rule(std::string const & i_Text);
+
+    // Apply the rule to the i_Length characters of i_Word and write the result in o_Word (which
+    // holds MAX_RULE_OUTPUT characters). Return its length, or 0 if the word is rejected because
+    // it would be too long.
+    size_t apply(char const * i_Word, size_t i_Length, char * o_Word) const;
+
+private:
+    struct Operation
+    {
+        char    type;
+        uint8_t arg1;
+        uint8_t arg2;
+    };
+
+    std::vector<Operation> m_operations;
+};
+
+// Read a rule file (one rule per line, empty lines and lines starting with # are skipped).
+// Throws std::invalid_argument if the file cannot be read or a rule is invalid.
+std::vector<Rule> loadRules(char const * i_FileName);
+
+#endif //RULES_IFT630
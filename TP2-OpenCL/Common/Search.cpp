@@ -0,0 +1,228 @@
+#include "Search.h"
+#include <algorithm>
+
+KeyspaceSearch::KeyspaceSearch(std::string const & i_Encoded, TargetSet const * i_Targets, FoundCallback const & i_OnFound)
+: m_encoded(i_Encoded)
+, m_targets(i_Targets)
+, m_onFound(i_OnFound)
+{
+}
+
+// Encode the possible solutions of i_Batch and report the ones of the first i_BatchSize lanes that
+// match a target. Return true if the single target looked for was found.
+template <size_t N>
+bool KeyspaceSearch::checkBatch(CandidateBatch<N, SEARCH_BATCH_WIDTH> const & i_Batch, uint64_t i_BatchSize, uint16_t i_ID) const
+{
+    // Possible solution of a lane (null-terminated to be printed)
+    char solution[N + 1] = {};
+
+    if (m_targets)
+    {
+        // Look every encoded possible solution up in the targets, and report each match
+        CandidateBatch<N, SEARCH_BATCH_WIDTH> encoded;
+        encodeBatch<N, SEARCH_BATCH_WIDTH>(i_Batch, encoded);
+        for (auto lane = 0U; lane < i_BatchSize; ++lane)
+        {
+            char encodedSolution[N];
+            for (auto i = 0U; i < N; ++i)
+            {
+                encodedSolution[i] = encoded.chars[i][lane];
+            }
+            if (m_targets->find(encodedSolution, N) != TargetSet::NOT_FOUND)
+            {
+                for (auto i = 0U; i < N; ++i)
+                {
+                    solution[i] = i_Batch.chars[i][lane];
+                }
+                m_onFound(i_ID, solution, encodedSolution, N);
+            }
+        }
+        return false;
+    }
+
+    // Pass the possible solutions in the encoder and check if one is what we look for
+    auto matches = matchBatch<N, SEARCH_BATCH_WIDTH>(i_Batch, m_encoded.data());
+    if (i_BatchSize < 64)
+    {
+        matches &= (1ULL << i_BatchSize) - 1;
+    }
+    if (matches == 0)
+    {
+        return false;
+    }
+
+    // Recover the matching lane
+    auto lane = 0U;
+    while (!(matches & (1ULL << lane)))
+    {
+        ++lane;
+    }
+    for (auto i = 0U; i < N; ++i)
+    {
+        solution[i] = i_Batch.chars[i][lane];
+    }
+    m_onFound(i_ID, solution, m_encoded.data(), N);
+    return true;
+}
+
+// Try the possible solutions [i_First, i_Last) of the keyspace, which all have N characters.
+// Return true if the single target looked for was found.
+template <size_t N>
+bool KeyspaceSearch::searchLength(Keyspace const & i_Keyspace, uint64_t i_First, uint64_t i_Last, uint16_t i_ID) const
+{
+    // Possible solution and its position in the keyspace
+    KeyspaceCursor cursor;
+    i_Keyspace.seek(i_First, cursor);
+
+    // Possible solutions encoded together
+    CandidateBatch<N, SEARCH_BATCH_WIDTH> batch;
+
+    for (auto numTries = i_First; numTries < i_Last; numTries += SEARCH_BATCH_WIDTH)
+    {
+        // Fill the batch with the next possible solutions (extra lanes repeat the last one)
+        auto batchSize = std::min<uint64_t>(SEARCH_BATCH_WIDTH, i_Last - numTries);
+        for (auto lane = 0U; lane < SEARCH_BATCH_WIDTH; ++lane)
+        {
+            for (auto i = 0U; i < N; ++i)
+            {
+                batch.chars[i][lane] = cursor.chars[i];
+            }
+
+            // Get next possible solution
+            if (lane + 1 < batchSize)
+            {
+                i_Keyspace.next(cursor);
+            }
+        }
+
+        if (checkBatch<N>(batch, batchSize, i_ID))
+        {
+            return true;
+        }
+
+        // Move to the first possible solution of the next batch
+        i_Keyspace.next(cursor);
+    }
+    return false;
+}
+
+// Call searchLength for possible solutions of i_Length characters (N at most)
+template <size_t N>
+bool KeyspaceSearch::searchRangeOfLength(size_t i_Length, Keyspace const & i_Keyspace, uint64_t i_First, uint64_t i_Last, uint16_t i_ID) const
+{
+    if (i_Length == N)
+    {
+        return searchLength<N>(i_Keyspace, i_First, i_Last, i_ID);
+    }
+    return searchRangeOfLength<N - 1>(i_Length, i_Keyspace, i_First, i_Last, i_ID);
+}
+
+template <>
+bool KeyspaceSearch::searchRangeOfLength<0>(size_t, Keyspace const &, uint64_t, uint64_t, uint16_t) const
+{
+    return false;
+}
+
+uint64_t KeyspaceSearch::searchRange(Keyspace const & i_Keyspace, uint64_t i_First, uint64_t i_Last, uint16_t i_ID) const
+{
+    // A range can hold possible solutions of several lengths, only the searched ones are tried
+    uint64_t numTries = 0;
+    for (auto first = i_First; first < i_Last; )
+    {
+        auto length = i_Keyspace.getLength(first);
+        auto end = std::min(i_Last, i_Keyspace.getFirstIndex(length + 1));
+        if (isSearched(length))
+        {
+            numTries += end - first;
+            if (searchRangeOfLength<SEARCH_MAX_LENGTH>(length, i_Keyspace, first, end, i_ID))
+            {
+                break;
+            }
+        }
+        first = end;
+    }
+    return numTries;
+}
+
+// Transpose the words of N characters in a batch (extra lanes repeat the last word) and check it
+template <size_t N>
+bool KeyspaceSearch::searchWordsOfLength(size_t i_Length, char const * i_Words, size_t i_Count, uint16_t i_ID) const
+{
+    if (i_Length != N)
+    {
+        return searchWordsOfLength<N - 1>(i_Length, i_Words, i_Count, i_ID);
+    }
+
+    CandidateBatch<N, SEARCH_BATCH_WIDTH> batch;
+    for (auto lane = 0U; lane < SEARCH_BATCH_WIDTH; ++lane)
+    {
+        auto word = std::min<size_t>(lane, i_Count - 1);
+        for (auto i = 0U; i < N; ++i)
+        {
+            batch.chars[i][lane] = i_Words[word * N + i];
+        }
+    }
+    return checkBatch<N>(batch, i_Count, i_ID);
+}
+
+template <>
+bool KeyspaceSearch::searchWordsOfLength<0>(size_t, char const *, size_t, uint16_t) const
+{
+    return false;
+}
+
+bool KeyspaceSearch::searchWords(char const * i_Words, size_t i_Count, size_t i_Length, uint16_t i_ID) const
+{
+    return i_Count > 0 && searchWordsOfLength<SEARCH_MAX_LENGTH>(i_Length, i_Words, i_Count, i_ID);
+}
+
+ChunkScheduler::ChunkScheduler()
+: m_numPartitions(1)
+{
+    m_partitions[0].next = 0;
+    m_partitions[0].last = 0;
+}
+
+void ChunkScheduler::reset(uint64_t i_First, uint64_t i_Last, std::vector<uint32_t> const & i_WorkerPartitions)
+{
+    m_workerPartitions = i_WorkerPartitions;
+    m_numPartitions = 1;
+    uint32_t numWorkers[MAX_PARTITIONS] = {};
+    for (auto partition : m_workerPartitions)
+    {
+        m_numPartitions = std::max(m_numPartitions, partition + 1);
+        ++numWorkers[partition];
+    }
+
+    auto first = i_First;
+    auto numAssigned = 0U;
+    for (auto i = 0U; i < m_numPartitions; ++i)
+    {
+        numAssigned += numWorkers[i];
+        auto last = i_First + static_cast<uint64_t>(static_cast<double>(i_Last - i_First) * numAssigned / std::max<size_t>(m_workerPartitions.size(), 1));
+        m_partitions[i].next = first;
+        m_partitions[i].last = i + 1 == m_numPartitions ? i_Last : last;
+        first = m_partitions[i].last;
+    }
+}
+
+bool ChunkScheduler::claimChunk(uint16_t i_ID, uint64_t i_ChunkSize, uint64_t & o_First, uint64_t & o_Last)
+{
+    auto ownPartition = i_ID < m_workerPartitions.size() ? m_workerPartitions[i_ID] : 0;
+    for (auto i = 0U; i < m_numPartitions; ++i)
+    {
+        auto & partition = m_partitions[(ownPartition + i) % m_numPartitions];
+        if (partition.next.load(std::memory_order_relaxed) >= partition.last)
+        {
+            continue;
+        }
+        auto first = partition.next.fetch_add(i_ChunkSize, std::memory_order_relaxed);
+        if (first < partition.last)
+        {
+            o_First = first;
+            o_Last  = std::min(first + i_ChunkSize, partition.last);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,139 @@
+#ifndef SEARCH_IFT630
+#define SEARCH_IFT630
+
+#include "EncodeBatch.h"
+#include "Keyspace.h"
+#include "TargetSet.h"
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Brute-force search engine shared by the Multithreaded and Distributed programs and by the
+// search benchmark. Worker threads claim chunks of work (from a ChunkScheduler, or from ranges
+// handed out by another process), a KeyspaceSearch encodes the possible solutions of each chunk
+// by SIMD batches, and the front end decides what to do with each match.
+
+// Number of possible solutions encoded at once (one per SIMD lane)
+size_t const SEARCH_BATCH_WIDTH = NATIVE_BATCH_WIDTH;
+
+// Longest possible solution the search can try (the encoder is specialized for each length)
+size_t const SEARCH_MAX_LENGTH = 16;
+
+// Encodes possible solutions and reports the ones whose encoded message is looked for. It has no
+// state of its own once built, so every worker thread can use the same search at once.
+class KeyspaceSearch
+{
+public:
+    // Called by worker thread i_ID for each possible solution whose encoded message is looked for.
+    // i_Solution (null-terminated) and i_Encoded both have i_Length characters.
+    typedef std::function<void(uint16_t i_ID, char const * i_Solution, char const * i_Encoded, size_t i_Length)> FoundCallback;
+
+    // Look for every encoded message of i_Targets (which must outlive the search), or only for
+    // i_Encoded if i_Targets is null
+    KeyspaceSearch(std::string const & i_Encoded, TargetSet const * i_Targets, FoundCallback const & i_OnFound);
+
+    // Check if possible solutions of i_Length characters can be what we look for: encode() keeps
+    // the length of messages, so only the lengths of the targets are tried
+    bool isSearched(size_t i_Length) const
+    {
+        return i_Length > 0 && i_Length <= SEARCH_MAX_LENGTH &&
+            (m_targets ? m_targets->hasLength(i_Length) : i_Length == m_encoded.length());
+    }
+
+    // Try the possible solutions [i_First, i_Last) of i_Keyspace, skipping the lengths not
+    // searched. With a single encoded message, stop once it is found. Return the number of
+    // possible solutions tried.
+    uint64_t searchRange(Keyspace const & i_Keyspace, uint64_t i_First, uint64_t i_Last, uint16_t i_ID) const;
+
+    // Try i_Count words of i_Length characters (a searched length) stored one after the other in
+    // i_Words, at most SEARCH_BATCH_WIDTH. Return true if the single encoded message looked for
+    // was found.
+    bool searchWords(char const * i_Words, size_t i_Count, size_t i_Length, uint16_t i_ID) const;
+
+private:
+    template <size_t N>
+    bool checkBatch(CandidateBatch<N, SEARCH_BATCH_WIDTH> const & i_Batch, uint64_t i_BatchSize, uint16_t i_ID) const;
+    template <size_t N>
+    bool searchLength(Keyspace const & i_Keyspace, uint64_t i_First, uint64_t i_Last, uint16_t i_ID) const;
+    template <size_t N>
+    bool searchRangeOfLength(size_t i_Length, Keyspace const & i_Keyspace, uint64_t i_First, uint64_t i_Last, uint16_t i_ID) const;
+    template <size_t N>
+    bool searchWordsOfLength(size_t i_Length, char const * i_Words, size_t i_Count, uint16_t i_ID) const;
+
+    std::string       m_encoded;
+    TargetSet const * m_targets;
+    FoundCallback     m_onFound;
+};
+
+// Work shared by worker threads and claimed by chunks: the range [first, last) of keyspace
+// indices, or of bytes of a wordlist. It is split in one partition per NUMA node of the workers.
+// Each partition has its own cache line, so workers of different nodes never touch the same
+// counter until one node runs out of work and helps the others.
+class ChunkScheduler
+{
+public:
+    // Largest number of partitions
+    static uint32_t const MAX_PARTITIONS = 64;
+
+    ChunkScheduler();
+
+    // Split the work [i_First, i_Last) between the partitions in proportion to their number of
+    // workers: worker i belongs to partition i_WorkerPartitions[i] (less than MAX_PARTITIONS).
+    // Without partitions, every worker shares a single one.
+    void reset(uint64_t i_First, uint64_t i_Last, std::vector<uint32_t> const & i_WorkerPartitions = std::vector<uint32_t>());
+
+    uint32_t getNumPartitions() const { return m_numPartitions; }
+
+    // Claim the next i_ChunkSize indices (or bytes) of the partition of worker i_ID, or of another
+    // partition once it is empty. Return false once all the work was claimed.
+    bool claimChunk(uint16_t i_ID, uint64_t i_ChunkSize, uint64_t & o_First, uint64_t & o_Last);
+
+private:
+    struct alignas(64) Partition
+    {
+        std::atomic<uint64_t> next;
+        uint64_t              last;
+    };
+
+    Partition             m_partitions[MAX_PARTITIONS];
+    uint32_t              m_numPartitions;
+    std::vector<uint32_t> m_workerPartitions;
+};
+
+// Solution found by one of several threads. The first thread to report one claims it, writes it,
+// and only then marks it ready: a thread which sees it ready always reads the whole solution.
+class FoundSolution
+{
+public:
+    FoundSolution() : m_isClaimed(false), m_isReady(false) {}
+
+    // Keep i_Solution unless a solution was already reported. Return false if one was.
+    bool report(std::string const & i_Solution)
+    {
+        if (m_isClaimed.exchange(true))
+        {
+            return false;
+        }
+        m_solution = i_Solution;
+        m_isReady.store(true, std::memory_order_release);
+        return true;
+    }
+
+    // Check if a solution was reported, even if it is not written yet (enough to stop searching)
+    bool isClaimed() const { return m_isClaimed.load(std::memory_order_relaxed); }
+
+    // Check if the solution can be read
+    bool isReady() const { return m_isReady.load(std::memory_order_acquire); }
+
+    // Solution reported, only valid once isReady() returned true
+    std::string const & get() const { return m_solution; }
+
+private:
+    std::atomic<bool> m_isClaimed;
+    std::atomic<bool> m_isReady;
+    std::string       m_solution;
+};
+
+#endif //SEARCH_IFT630
@@ -0,0 +1,86 @@
+#include "TargetSet.h"
+#include <fstream>
+
+TargetSet::TargetSet(std::vector<std::string> const & i_Targets)
+: m_offsets(1, 0)
+, m_prefixFilter(65536 / 64, 0)
+{
+    // Keep the table at most half full so probe sequences stay short
+    auto numSlots = 16ULL;
+    while (numSlots < 2 * i_Targets.size())
+    {
+        numSlots *= 2;
+    }
+    m_slots.assign(numSlots, Slot());
+    for (auto & slot : m_slots)
+    {
+        slot.index = EMPTY;
+    }
+    m_slotMask = numSlots - 1;
+
+    for (auto const & target : i_Targets)
+    {
+        if (find(target.data(), target.length()) != NOT_FOUND)
+        {
+            continue;
+        }
+
+        auto index = static_cast<uint32_t>(size());
+        m_chars.insert(m_chars.end(), target.begin(), target.end());
+        m_offsets.push_back(m_chars.size());
+
+        if (m_hasLength.size() <= target.length())
+        {
+            m_hasLength.resize(target.length() + 1, false);
+        }
+        m_hasLength[target.length()] = true;
+
+        auto prefix = getPrefix(target.data(), target.length());
+        m_prefixFilter[prefix / 64] |= 1ULL << (prefix % 64);
+
+        auto hash = getHash(target.data(), target.length());
+        auto slot = hash & m_slotMask;
+        while (m_slots[slot].index != EMPTY)
+        {
+            slot = (slot + 1) & m_slotMask;
+        }
+        m_slots[slot].fingerprint = static_cast<uint32_t>(hash >> 32);
+        m_slots[slot].index = index;
+    }
+}
+
+std::string TargetSet::getTarget(size_t i_Index) const
+{
+    return std::string(m_chars.begin() + m_offsets[i_Index], m_chars.begin() + m_offsets[i_Index + 1]);
+}
+
+bool loadTargets(char const * i_FileName, std::vector<std::string> & o_Targets)
+{
+    std::ifstream file(i_FileName);
+    if (!file)
+    {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        line.erase(line.find_last_not_of(" \r\t") + 1);
+        if (line.empty())
+        {
+            continue;
+        }
+        if (line.length() % 2 != 0 || line.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)
+        {
+            return false;
+        }
+
+        std::string target(line.length() / 2, 0);
+        for (auto i = 0U; i < target.length(); ++i)
+        {
+            target[i] = static_cast<char>(std::stoi(line.substr(2 * i, 2), nullptr, 16));
+        }
+        o_Targets.push_back(target);
+    }
+    return true;
+}
@@ -0,0 +1,108 @@
+#ifndef TARGET_SET_IFT630
+#define TARGET_SET_IFT630
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Set of encoded messages looked for, built once and then only queried (queries are thread-safe).
+//
+// Lookups are meant to be made for every encoded candidate, so they must be cheap when the
+// candidate is not a target (almost always):
+//  - a 64 Kbit filter indexed by the first two characters rejects most candidates with one load
+//    (it stays in L1 cache whatever the number of targets)
+//  - the others are looked up in an open-addressing table with linear probing: slots hold a
+//    fingerprint of the hash and the index of the target, so probing reads contiguous memory and
+//    targets are only compared when fingerprints match
+//  - targets are stored one after the other in a single buffer
+class TargetSet
+{
+public:
+    static size_t const NOT_FOUND = ~static_cast<size_t>(0);
+
+    // Duplicate targets are only kept once
+    explicit TargetSet(std::vector<std::string> const & i_Targets);
+
+    size_t size() const { return m_offsets.size() - 1; }
+    std::string getTarget(size_t i_Index) const;
+
+    // Check if a target has i_Length characters
+    bool hasLength(size_t i_Length) const { return i_Length < m_hasLength.size() && m_hasLength[i_Length]; }
+
+    // Index of the target equal to the i_Length characters of i_Encoded, or NOT_FOUND
+    size_t find(char const * i_Encoded, size_t i_Length) const
+    {
+        auto prefix = getPrefix(i_Encoded, i_Length);
+        if (!(m_prefixFilter[prefix / 64] & (1ULL << (prefix % 64))))
+        {
+            return NOT_FOUND;
+        }
+
+        auto hash = getHash(i_Encoded, i_Length);
+        auto fingerprint = static_cast<uint32_t>(hash >> 32);
+        for (auto slot = hash & m_slotMask; m_slots[slot].index != EMPTY; slot = (slot + 1) & m_slotMask)
+        {
+            if (m_slots[slot].fingerprint == fingerprint && isTarget(m_slots[slot].index, i_Encoded, i_Length))
+            {
+                return m_slots[slot].index;
+            }
+        }
+        return NOT_FOUND;
+    }
+
+private:
+    static uint32_t const EMPTY = ~0U;
+
+    struct Slot
+    {
+        uint32_t fingerprint;
+        uint32_t index;
+    };
+
+    static uint32_t getPrefix(char const * i_Encoded, size_t i_Length)
+    {
+        auto prefix = i_Length > 0 ? static_cast<uint8_t>(i_Encoded[0]) : 0U;
+        return i_Length > 1 ? prefix | static_cast<uint8_t>(i_Encoded[1]) << 8 : prefix;
+    }
+
+    // FNV-1a
+    static uint64_t getHash(char const * i_Encoded, size_t i_Length)
+    {
+        auto hash = 14695981039346656037ULL ^ i_Length;
+        for (auto i = 0U; i < i_Length; ++i)
+        {
+            hash = (hash ^ static_cast<uint8_t>(i_Encoded[i])) * 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    bool isTarget(size_t i_Index, char const * i_Encoded, size_t i_Length) const
+    {
+        if (m_offsets[i_Index + 1] - m_offsets[i_Index] != i_Length)
+        {
+            return false;
+        }
+        auto target = m_chars.data() + m_offsets[i_Index];
+        for (auto i = 0U; i < i_Length; ++i)
+        {
+            if (target[i] != i_Encoded[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::vector<char>     m_chars;
+    std::vector<size_t>   m_offsets;
+    std::vector<bool>     m_hasLength;
+    std::vector<uint64_t> m_prefixFilter;
+    std::vector<Slot>     m_slots;
+    uint64_t              m_slotMask;
+};
+
+// Read encoded messages written in hexadecimal, one per line (empty lines are skipped). Return
+// false if the file cannot be read or a line is not hexadecimal.
+bool loadTargets(char const * i_FileName, std::vector<std::string> & o_Targets);
+
+#endif //TARGET_SET_IFT630
@@ -0,0 +1,318 @@
+#include "Topology.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <thread>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#endif
+
+bool parseAffinityPolicy(char const * i_Name, AffinityPolicy & o_Policy)
+{
+    static std::pair<char const *, AffinityPolicy> const POLICIES[] =
+    {
+        { "none",     AffinityPolicy::NONE     },
+        { "compact",  AffinityPolicy::COMPACT  },
+        { "scatter",  AffinityPolicy::SCATTER  },
+        { "physical", AffinityPolicy::PHYSICAL },
+    };
+    for (auto const & policy : POLICIES)
+    {
+        if (strcmp(i_Name, policy.first) == 0)
+        {
+            o_Policy = policy.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+// One processor per core, socket and node, used when the topology cannot be read
+static std::vector<LogicalCpu> getFlatTopology()
+{
+    std::vector<LogicalCpu> cpus;
+    auto numCpus = std::max(std::thread::hardware_concurrency(), 1U);
+    for (auto i = 0U; i < numCpus; ++i)
+    {
+        LogicalCpu cpu = { static_cast<uint16_t>(i / 64), static_cast<uint16_t>(i % 64), i, 0, 0 };
+        cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+#ifdef _WIN32
+
+std::vector<LogicalCpu> getCpuTopology()
+{
+    DWORD size = 0;
+    GetLogicalProcessorInformationEx(RelationAll, nullptr, &size);
+    std::vector<char> buffer(size);
+    if (size == 0 || !GetLogicalProcessorInformationEx(RelationAll,
+        reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *>(buffer.data()), &size))
+    {
+        return getFlatTopology();
+    }
+
+    // Processors of each core, socket and node, as group masks
+    struct GroupSet
+    {
+        WORD      group;
+        KAFFINITY mask;
+        uint32_t  id;
+    };
+    std::vector<GroupSet> cores;
+    std::vector<GroupSet> packages;
+    std::vector<GroupSet> nodes;
+    auto numPackages = 0U;
+    for (DWORD offset = 0; offset < size; )
+    {
+        auto record = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX const *>(buffer.data() + offset);
+        switch (record->Relationship)
+        {
+        case RelationProcessorCore:
+        {
+            GroupSet core = { record->Processor.GroupMask[0].Group, record->Processor.GroupMask[0].Mask, static_cast<uint32_t>(cores.size()) };
+            cores.push_back(core);
+            break;
+        }
+        case RelationProcessorPackage:
+            for (auto i = 0U; i < record->Processor.GroupCount; ++i)
+            {
+                GroupSet package = { record->Processor.GroupMask[i].Group, record->Processor.GroupMask[i].Mask, numPackages };
+                packages.push_back(package);
+            }
+            ++numPackages;
+            break;
+        case RelationNumaNode:
+        {
+            GroupSet node = { record->NumaNode.GroupMask.Group, record->NumaNode.GroupMask.Mask, record->NumaNode.NodeNumber };
+            nodes.push_back(node);
+            break;
+        }
+        default:
+            break;
+        }
+        offset += record->Size;
+    }
+
+    // Set holding a processor
+    auto findSet = [](std::vector<GroupSet> const & i_Sets, WORD i_Group, uint32_t i_Index)
+    {
+        for (auto const & set : i_Sets)
+        {
+            if (set.group == i_Group && (set.mask >> i_Index) & 1)
+            {
+                return set.id;
+            }
+        }
+        return 0U;
+    };
+
+    std::vector<LogicalCpu> cpus;
+    for (auto const & core : cores)
+    {
+        for (auto i = 0U; i < 8 * sizeof(KAFFINITY); ++i)
+        {
+            if ((core.mask >> i) & 1)
+            {
+                LogicalCpu cpu = { core.group, static_cast<uint16_t>(i), core.id,
+                                   findSet(packages, core.group, i), findSet(nodes, core.group, i) };
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return cpus.empty() ? getFlatTopology() : cpus;
+}
+
+bool pinCurrentThread(LogicalCpu const & i_Cpu)
+{
+    GROUP_AFFINITY affinity = {};
+    affinity.Group = i_Cpu.group;
+    affinity.Mask  = static_cast<KAFFINITY>(1) << i_Cpu.index;
+    return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+}
+
+#else
+
+// Read the number written in a sysfs file
+static bool readNumber(std::string const & i_Path, uint32_t & o_Value)
+{
+    std::ifstream file(i_Path);
+    return static_cast<bool>(file >> o_Value);
+}
+
+// Parse a list of processors such as "0-3,8,10-11"
+static std::vector<uint32_t> parseCpuList(std::string const & i_List)
+{
+    std::vector<uint32_t> cpus;
+    for (size_t pos = 0; pos < i_List.length(); )
+    {
+        auto end = i_List.find(',', pos);
+        end = end == std::string::npos ? i_List.length() : end;
+        unsigned int first;
+        unsigned int last;
+        auto range = i_List.substr(pos, end - pos);
+        auto numRead = sscanf(range.c_str(), "%u-%u", &first, &last);
+        if (numRead == 1)
+        {
+            last = first;
+        }
+        for (auto cpu = first; numRead > 0 && cpu <= last; ++cpu)
+        {
+            cpus.push_back(cpu);
+        }
+        pos = end + 1;
+    }
+    return cpus;
+}
+
+std::vector<LogicalCpu> getCpuTopology()
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    {
+        return getFlatTopology();
+    }
+
+    // NUMA node of each processor
+    std::map<uint32_t, uint32_t> nodeOf;
+    if (auto dir = opendir("/sys/devices/system/node"))
+    {
+        while (auto entry = readdir(dir))
+        {
+            unsigned int node;
+            char extra;
+            if (sscanf(entry->d_name, "node%u%c", &node, &extra) != 1)
+            {
+                continue;
+            }
+            std::ifstream file("/sys/devices/system/node/" + std::string(entry->d_name) + "/cpulist");
+            std::string list;
+            std::getline(file, list);
+            for (auto cpu : parseCpuList(list))
+            {
+                nodeOf[cpu] = node;
+            }
+        }
+        closedir(dir);
+    }
+
+    // Core IDs are only unique within a socket: number cores across the machine
+    std::map<std::pair<uint32_t, uint32_t>, uint32_t> coreOf;
+
+    std::vector<LogicalCpu> cpus;
+    for (auto i = 0U; i < CPU_SETSIZE; ++i)
+    {
+        if (!CPU_ISSET(i, &allowed))
+        {
+            continue;
+        }
+
+        auto path = "/sys/devices/system/cpu/cpu" + std::to_string(i) + "/topology/";
+        auto coreID = i;
+        auto package = 0U;
+        readNumber(path + "core_id", coreID);
+        readNumber(path + "physical_package_id", package);
+        auto core = coreOf.insert(std::make_pair(std::make_pair(package, coreID), static_cast<uint32_t>(coreOf.size()))).first->second;
+
+        LogicalCpu cpu = { 0, static_cast<uint16_t>(i), core, package, nodeOf.count(i) ? nodeOf[i] : 0 };
+        cpus.push_back(cpu);
+    }
+    return cpus.empty() ? getFlatTopology() : cpus;
+}
+
+bool pinCurrentThread(LogicalCpu const & i_Cpu)
+{
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(i_Cpu.index, &cpus);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+}
+
+#endif
+
+std::vector<LogicalCpu> getThreadPlacement(std::vector<LogicalCpu> const & i_Cpus, AffinityPolicy i_Policy)
+{
+    std::vector<LogicalCpu> placement;
+    if (i_Policy == AffinityPolicy::NONE)
+    {
+        return placement;
+    }
+
+    // Order processors by node, socket and core, so hyperthread siblings are next to each other
+    auto cpus = i_Cpus;
+    std::sort(cpus.begin(), cpus.end(), [](LogicalCpu const & i_A, LogicalCpu const & i_B)
+    {
+        if (i_A.node    != i_B.node)    return i_A.node    < i_B.node;
+        if (i_A.package != i_B.package) return i_A.package < i_B.package;
+        if (i_A.core    != i_B.core)    return i_A.core    < i_B.core;
+        if (i_A.group   != i_B.group)   return i_A.group   < i_B.group;
+        return i_A.index < i_B.index;
+    });
+
+    // Rank of each processor among the hyperthreads of its core
+    std::vector<uint32_t> sibling(cpus.size(), 0);
+    auto maxSibling = 0U;
+    for (auto i = 1U; i < cpus.size(); ++i)
+    {
+        sibling[i] = cpus[i].core == cpus[i - 1].core ? sibling[i - 1] + 1 : 0;
+        maxSibling = std::max(maxSibling, sibling[i]);
+    }
+
+    switch (i_Policy)
+    {
+    case AffinityPolicy::COMPACT:
+        placement = cpus;
+        break;
+    case AffinityPolicy::PHYSICAL:
+        for (auto i = 0U; i < cpus.size(); ++i)
+        {
+            if (sibling[i] == 0)
+            {
+                placement.push_back(cpus[i]);
+            }
+        }
+        break;
+    case AffinityPolicy::SCATTER:
+    {
+        // Processors of each node, the first hyperthread of every core before the second ones
+        std::map<uint32_t, std::vector<LogicalCpu>> nodes;
+        for (auto level = 0U; level <= maxSibling; ++level)
+        {
+            for (auto i = 0U; i < cpus.size(); ++i)
+            {
+                if (sibling[i] == level)
+                {
+                    nodes[cpus[i].node].push_back(cpus[i]);
+                }
+            }
+        }
+
+        // Take one processor of each node in turn
+        for (auto i = 0U; placement.size() < cpus.size(); ++i)
+        {
+            for (auto const & node : nodes)
+            {
+                if (i < node.second.size())
+                {
+                    placement.push_back(node.second[i]);
+                }
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return placement;
+}
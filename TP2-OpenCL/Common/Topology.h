@@ -0,0 +1,45 @@
+#ifndef TOPOLOGY_IFT630
+#define TOPOLOGY_IFT630
+
+#include <vector>
+#include <stdint.h>
+
+// Logical processor (hardware thread) the process may run on, and where it sits in the machine
+struct LogicalCpu
+{
+    // Index of the processor in its group (Windows groups hold at most 64 processors, Linux has
+    // a single group)
+    uint16_t group;
+    uint16_t index;
+
+    // Physical core, socket and NUMA node of the processor. Cores are numbered across the whole
+    // machine, so hyperthread siblings are the processors with the same core.
+    uint32_t core;
+    uint32_t package;
+    uint32_t node;
+};
+
+// How threads are placed on the logical processors
+enum class AffinityPolicy
+{
+    NONE,     // let the OS schedule threads
+    COMPACT,  // fill a core (all its hyperthreads), then the next core of the socket, then the next socket
+    SCATTER,  // one thread per core, alternating NUMA nodes, before reusing hyperthread siblings
+    PHYSICAL  // one thread per physical core, filling a node before the next one
+};
+
+// Parse "none", "compact", "scatter" or "physical". Return false for anything else.
+bool parseAffinityPolicy(char const * i_Name, AffinityPolicy & o_Policy);
+
+// Logical processors the process is allowed to run on. Falls back to a single node, socket and
+// core per processor when the topology cannot be read.
+std::vector<LogicalCpu> getCpuTopology();
+
+// Order in which threads are placed on i_Cpus with i_Policy: thread i runs on processor i modulo
+// the size of the result (empty for NONE)
+std::vector<LogicalCpu> getThreadPlacement(std::vector<LogicalCpu> const & i_Cpus, AffinityPolicy i_Policy);
+
+// Restrict the calling thread to i_Cpu. Return false if the OS refused.
+bool pinCurrentThread(LogicalCpu const & i_Cpu);
+
+#endif //TOPOLOGY_IFT630
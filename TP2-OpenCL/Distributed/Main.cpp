@@ -0,0 +1,630 @@
+#include "../../TP2-MPI/MPIUtils.h"
+#include "../Common/Encode.h"
+#include "../Common/Keyspace.h"
+#include "../Common/Search.h"
+#include "../Common/TargetSet.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mpi.h>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Brute-force search of the Multithreaded program spread over MPI processes.
+//
+// Usage: mpiexec -n <processes> Distributed [--mask MASK] [--min-length LENGTH] [--targets FILE]
+//                                           [--threads COUNT] [-1 CHARSET] ... [-4 CHARSET]
+//
+// The manager hands out ranges of keyspace indices to the processes (itself included) on demand.
+// Ranges shrink as the keyspace runs out (guided self-scheduling) so every process finishes at
+// about the same time. In each process, the main thread only talks to the manager while worker
+// threads claim chunks of the local ranges and try them with the search engine of the
+// Multithreaded program (Common/Search.h). The next range is asked for before the local ones run
+// out, so workers never wait for the network.
+//
+// Once a solution is found, the manager broadcasts it to every process (non-blocking broadcast
+// posted by every process at startup), which stop their workers after their current chunk.
+// With --targets, every match is reported and the whole keyspace is tried.
+
+// The word the program looks for
+char const SOLUTION[] = "jeremy";
+
+// Length of the word to decode
+size_t const LENGTH = sizeof(SOLUTION) - 1;
+
+// Encoded message we want to obtain after applying the encoding algorithm on possible solutions
+auto const ENCODED = encode(SOLUTION);
+
+// Number of possible solutions a worker thread claims at once (a multiple of SEARCH_BATCH_WIDTH)
+uint64_t const CHUNK_SIZE = 1 << 16;
+
+// Largest range of possible solutions the manager hands out at once
+uint64_t const RANGE_SIZE = CHUNK_SIZE << 12;
+
+// Interval between two polls of the messages by the main thread of a process
+auto const POLL_INTERVAL = std::chrono::milliseconds(1);
+
+// Interval between two progress reports
+auto const REPORT_INTERVAL = std::chrono::seconds(1);
+
+// Tags of the messages exchanged with the manager
+int const TAG_RANGE_REQ = 1;
+int const TAG_RANGE     = 2;
+int const TAG_PROGRESS  = 3;
+int const TAG_FOUND     = 4;
+int const TAG_DONE      = 5;
+
+// Range [first, last) of keyspace indices
+struct Range
+{
+    uint64_t first;
+    uint64_t last;
+};
+
+// Ranges of the process not yet claimed by its worker threads, and number of indices they hold
+std::deque<Range> g_Ranges;
+uint64_t g_NumQueued = 0;
+
+// Set once the manager has no range left for the process
+bool g_AreRangesOver = false;
+
+// Set once the search must stop: a solution was found, here or in another process
+bool g_IsCancelled = false;
+
+// Protects the variables above, and wakes up worker threads waiting for a range
+std::mutex g_RangesMutex;
+std::condition_variable g_RangesChanged;
+
+// Solution found by a worker thread of the process, or received by the manager
+FoundSolution g_Solution;
+
+// Counters of the process, updated by worker threads after each chunk
+std::atomic<uint64_t> g_NumTries(0);
+std::atomic<uint64_t> g_Progress(0);
+std::atomic<uint64_t> g_NumMatches(0);
+
+// Number of worker threads of the process still running
+std::atomic<uint32_t> g_NumActiveThreads(0);
+
+// Encoded messages looked for with --targets (ENCODED is looked for otherwise)
+std::unique_ptr<TargetSet> g_Targets;
+
+// Search engine shared by the worker threads of the process
+std::unique_ptr<KeyspaceSearch> g_Search;
+
+// Communicator of the cancel broadcast, kept apart from the messages of the manager
+MPI_Comm g_CancelComm;
+
+// Give a range to the worker threads of the process
+void pushRange(Range const & i_Range)
+{
+    std::lock_guard<std::mutex> lock(g_RangesMutex);
+    g_Ranges.push_back(i_Range);
+    g_NumQueued += i_Range.last - i_Range.first;
+    g_RangesChanged.notify_all();
+}
+
+// Let the worker threads of the process stop once the ranges they have are done
+void endRanges()
+{
+    std::lock_guard<std::mutex> lock(g_RangesMutex);
+    g_AreRangesOver = true;
+    g_RangesChanged.notify_all();
+}
+
+// Stop the worker threads of the process after their current chunk
+void cancelSearch()
+{
+    std::lock_guard<std::mutex> lock(g_RangesMutex);
+    g_IsCancelled = true;
+    g_RangesChanged.notify_all();
+}
+
+uint64_t getNumQueued()
+{
+    std::lock_guard<std::mutex> lock(g_RangesMutex);
+    return g_NumQueued;
+}
+
+bool areRangesOver()
+{
+    std::lock_guard<std::mutex> lock(g_RangesMutex);
+    return g_AreRangesOver;
+}
+
+// Take the next chunk of the ranges of the process, waiting for the manager if there is none.
+// Return false once there is nothing left to try.
+bool claimChunk(Range & o_Chunk)
+{
+    std::unique_lock<std::mutex> lock(g_RangesMutex);
+    g_RangesChanged.wait(lock, []() { return !g_Ranges.empty() || g_AreRangesOver || g_IsCancelled; });
+    if (g_Ranges.empty() || g_IsCancelled)
+    {
+        return false;
+    }
+
+    auto & range = g_Ranges.front();
+    o_Chunk.first = range.first;
+    o_Chunk.last  = std::min(range.first + CHUNK_SIZE, range.last);
+    range.first = o_Chunk.last;
+    g_NumQueued -= o_Chunk.last - o_Chunk.first;
+    if (range.first == range.last)
+    {
+        g_Ranges.pop_front();
+    }
+    return true;
+}
+
+// Report a possible solution whose encoded message is looked for (called by worker threads)
+void onFound(uint32_t i_Rank, uint16_t i_ID, char const * i_Solution)
+{
+    printf("Process %u thread %d: FOUND SOLUTION \"%s\"\n", i_Rank, i_ID, i_Solution);
+    if (g_Targets)
+    {
+        g_NumMatches.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        g_Solution.report(i_Solution);
+        cancelSearch();
+    }
+}
+
+// Code executed by each worker thread of a process
+void worker(Keyspace const & i_Keyspace, uint16_t i_ID)
+{
+    Range chunk;
+    while (claimChunk(chunk))
+    {
+        g_NumTries.fetch_add(g_Search->searchRange(i_Keyspace, chunk.first, chunk.last, i_ID), std::memory_order_relaxed);
+        g_Progress.fetch_add(chunk.last - chunk.first, std::memory_order_relaxed);
+    }
+    g_NumActiveThreads.fetch_sub(1);
+}
+
+// Start the worker threads of the process
+std::vector<std::thread> startWorkers(Keyspace const & i_Keyspace, uint32_t i_Rank, uint32_t i_NumThreads)
+{
+    g_Search.reset(new KeyspaceSearch(ENCODED, g_Targets.get(),
+        [i_Rank](uint16_t i_ID, char const * i_Solution, char const *, size_t) { onFound(i_Rank, i_ID, i_Solution); }));
+
+    g_NumActiveThreads = i_NumThreads;
+    std::vector<std::thread> workers;
+    for (auto i = 0U; i < i_NumThreads; ++i)
+    {
+        workers.emplace_back(worker, std::cref(i_Keyspace), static_cast<uint16_t>(i));
+    }
+    return workers;
+}
+
+// Code executed by the main thread of the manager process
+void runManager(Keyspace const & i_Keyspace, uint64_t i_FirstIndex, uint64_t i_LastIndex, uint32_t i_NumThreads, uint32_t i_NumProc)
+{
+    using namespace std::chrono;
+    auto start = steady_clock::now();
+    auto lastReport = start;
+
+    auto workers = startWorkers(i_Keyspace, MANAGER_ID, i_NumThreads);
+
+    // Next range to hand out: ranges are a share of what is left, so the last ones are small
+    auto nextIndex = i_FirstIndex;
+    auto takeRange = [&]()
+    {
+        Range range = { nextIndex, nextIndex };
+        if (!g_Solution.isClaimed() && nextIndex < i_LastIndex)
+        {
+            auto size = (i_LastIndex - nextIndex) / (2 * i_NumProc);
+            size = std::max(std::min(size, RANGE_SIZE), CHUNK_SIZE);
+            range.last = std::min(nextIndex + size, i_LastIndex);
+            nextIndex = range.last;
+        }
+        return range;
+    };
+
+    // Broadcast of the solution found (empty if none), posted once it is known
+    char solution[SEARCH_MAX_LENGTH + 1] = {};
+    MPI_Request cancelRequest = MPI_REQUEST_NULL;
+    auto broadcastSolution = [&](char const * i_Solution)
+    {
+        strncpy(solution, i_Solution, SEARCH_MAX_LENGTH);
+        MPI_Ibcast(solution, SEARCH_MAX_LENGTH + 1, MPI_CHAR, MANAGER_ID, g_CancelComm, &cancelRequest);
+        cancelSearch();
+    };
+
+    // Counters reported by the other processes
+    std::vector<uint64_t> numTries(i_NumProc, 0);
+    std::vector<uint64_t> progress(i_NumProc, 0);
+    std::vector<uint64_t> numMatches(i_NumProc, 0);
+    auto numProcDone = 1U;
+    auto isCancelSent = false;
+
+    while (numProcDone < i_NumProc || g_NumActiveThreads > 0)
+    {
+        // Feed our own worker threads like any other process
+        if (!areRangesOver() && getNumQueued() < RANGE_SIZE / 2)
+        {
+            auto range = takeRange();
+            if (range.first < range.last)
+            {
+                pushRange(range);
+            }
+            else
+            {
+                endRanges();
+            }
+        }
+
+        // Serve the other processes
+        auto hasMessage = 0;
+        MPI_Status status;
+        MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &hasMessage, &status);
+        while (hasMessage)
+        {
+            auto source = status.MPI_SOURCE;
+            uint64_t buf[3];
+            switch (status.MPI_TAG)
+            {
+            case TAG_RANGE_REQ:
+            {
+                MPI_Recv(nullptr, 0, MPI_UINT64_T, source, TAG_RANGE_REQ, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                auto range = takeRange();
+                buf[0] = range.first;
+                buf[1] = range.last;
+                MPI_Send(buf, 2, MPI_UINT64_T, source, TAG_RANGE, MPI_COMM_WORLD);
+                break;
+            }
+            case TAG_PROGRESS:
+                MPI_Recv(buf, 2, MPI_UINT64_T, source, TAG_PROGRESS, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                numTries[source] = buf[0];
+                progress[source] = buf[1];
+                break;
+            case TAG_FOUND:
+            {
+                char found[SEARCH_MAX_LENGTH + 1] = {};
+                MPI_Recv(found, SEARCH_MAX_LENGTH, MPI_CHAR, source, TAG_FOUND, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                g_Solution.report(found);
+                break;
+            }
+            case TAG_DONE:
+                MPI_Recv(buf, 3, MPI_UINT64_T, source, TAG_DONE, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                numTries[source]   = buf[0];
+                progress[source]   = buf[1];
+                numMatches[source] = buf[2];
+                ++numProcDone;
+                break;
+            default:
+                MPI_Recv(nullptr, 0, MPI_BYTE, source, status.MPI_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                break;
+            }
+            MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &hasMessage, &status);
+        }
+
+        // Stop every process as soon as a solution is known (and fully written)
+        if (g_Solution.isReady() && !isCancelSent)
+        {
+            broadcastSolution(g_Solution.get().c_str());
+            isCancelSent = true;
+        }
+        if (isCancelSent)
+        {
+            auto isSent = 0;
+            MPI_Test(&cancelRequest, &isSent, MPI_STATUS_IGNORE);
+        }
+
+        auto now = steady_clock::now();
+        if (now - lastReport >= REPORT_INTERVAL)
+        {
+            numTries[MANAGER_ID] = g_NumTries.load(std::memory_order_relaxed);
+            progress[MANAGER_ID] = g_Progress.load(std::memory_order_relaxed);
+            uint64_t totalTries = 0;
+            uint64_t totalProgress = 0;
+            for (auto i = 0U; i < i_NumProc; ++i)
+            {
+                totalTries += numTries[i];
+                totalProgress += progress[i];
+            }
+            printf("Manager: %.2f M tries/s, %.2f%% covered, %u of %u processes done\n",
+                totalTries / duration<double>(now - start).count() / 1e6,
+                100.0 * totalProgress / std::max<uint64_t>(i_LastIndex - i_FirstIndex, 1),
+                numProcDone - 1, i_NumProc - 1);
+            lastReport = now;
+        }
+
+        std::this_thread::sleep_for(POLL_INTERVAL);
+    }
+
+    for (auto & thread : workers)
+    {
+        thread.join();
+    }
+
+    // Release the processes waiting for the broadcast if nothing was found
+    if (!isCancelSent)
+    {
+        broadcastSolution("");
+    }
+    MPI_Wait(&cancelRequest, MPI_STATUS_IGNORE);
+
+    numTries[MANAGER_ID] = g_NumTries;
+    numMatches[MANAGER_ID] = g_NumMatches;
+    uint64_t totalTries = 0;
+    uint64_t totalMatches = 0;
+    for (auto i = 0U; i < i_NumProc; ++i)
+    {
+        totalTries += numTries[i];
+        totalMatches += numMatches[i];
+    }
+    printf("Manager: %llu possible solutions tried by %u processes\n",
+        static_cast<unsigned long long>(totalTries), i_NumProc);
+
+    if (g_Targets)
+    {
+        printf("Manager: %llu matches\n", static_cast<unsigned long long>(totalMatches));
+    }
+    else if (g_Solution.isReady())
+    {
+        printf("Manager: Solution is \"%s\"\n", g_Solution.get().c_str());
+    }
+    else
+    {
+        printf("Manager: Could not find any solution\n");
+    }
+}
+
+// Code executed by the main thread of every other process
+void runWorker(Keyspace const & i_Keyspace, uint32_t i_NumThreads, uint32_t i_CurrProc)
+{
+    using namespace std::chrono;
+    auto lastReport = steady_clock::now();
+
+    // Listen for the solution broadcast by the manager from the start
+    char solution[SEARCH_MAX_LENGTH + 1] = {};
+    MPI_Request cancelRequest;
+    MPI_Ibcast(solution, SEARCH_MAX_LENGTH + 1, MPI_CHAR, MANAGER_ID, g_CancelComm, &cancelRequest);
+    auto isCancelReceived = false;
+
+    auto workers = startWorkers(i_Keyspace, i_CurrProc, i_NumThreads);
+
+    uint64_t range[2];
+    MPI_Request rangeRequest = MPI_REQUEST_NULL;
+    auto isFoundSent = false;
+    while (g_NumActiveThreads > 0)
+    {
+        // Ask for the next range before the local ones run out
+        if (rangeRequest == MPI_REQUEST_NULL && !areRangesOver() && getNumQueued() < RANGE_SIZE / 2)
+        {
+            MPI_Send(nullptr, 0, MPI_UINT64_T, MANAGER_ID, TAG_RANGE_REQ, MPI_COMM_WORLD);
+            MPI_Irecv(range, 2, MPI_UINT64_T, MANAGER_ID, TAG_RANGE, MPI_COMM_WORLD, &rangeRequest);
+        }
+        if (rangeRequest != MPI_REQUEST_NULL)
+        {
+            auto hasArrived = 0;
+            MPI_Test(&rangeRequest, &hasArrived, MPI_STATUS_IGNORE);
+            if (hasArrived)
+            {
+                if (range[0] < range[1])
+                {
+                    Range received = { range[0], range[1] };
+                    pushRange(received);
+                }
+                else
+                {
+                    endRanges();
+                }
+            }
+        }
+
+        // Stop as soon as the manager broadcasts a solution
+        if (!isCancelReceived)
+        {
+            auto hasArrived = 0;
+            MPI_Test(&cancelRequest, &hasArrived, MPI_STATUS_IGNORE);
+            if (hasArrived)
+            {
+                isCancelReceived = true;
+                if (solution[0] != 0)
+                {
+                    cancelSearch();
+                }
+            }
+        }
+
+        // Tell the manager right away if we found the solution
+        if (g_Solution.isReady() && !isFoundSent)
+        {
+            MPI_Send(g_Solution.get().c_str(), static_cast<int>(g_Solution.get().length()), MPI_CHAR, MANAGER_ID, TAG_FOUND, MPI_COMM_WORLD);
+            isFoundSent = true;
+        }
+
+        auto now = steady_clock::now();
+        if (now - lastReport >= REPORT_INTERVAL)
+        {
+            uint64_t counters[2] = { g_NumTries.load(std::memory_order_relaxed), g_Progress.load(std::memory_order_relaxed) };
+            MPI_Send(counters, 2, MPI_UINT64_T, MANAGER_ID, TAG_PROGRESS, MPI_COMM_WORLD);
+            lastReport = now;
+        }
+
+        std::this_thread::sleep_for(POLL_INTERVAL);
+    }
+
+    for (auto & thread : workers)
+    {
+        thread.join();
+    }
+
+    // The manager answers every range request, even after a solution was found
+    MPI_Wait(&rangeRequest, MPI_STATUS_IGNORE);
+    if (g_Solution.isReady() && !isFoundSent)
+    {
+        MPI_Send(g_Solution.get().c_str(), static_cast<int>(g_Solution.get().length()), MPI_CHAR, MANAGER_ID, TAG_FOUND, MPI_COMM_WORLD);
+    }
+
+    uint64_t counters[3] = { g_NumTries, g_Progress, g_NumMatches };
+    MPI_Send(counters, 3, MPI_UINT64_T, MANAGER_ID, TAG_DONE, MPI_COMM_WORLD);
+    if (!isCancelReceived)
+    {
+        MPI_Wait(&cancelRequest, MPI_STATUS_IGNORE);
+    }
+}
+
+// Give the targets read by the manager to every process. Return false if the manager could not
+// read them.
+bool broadcastTargets(char const * i_FileName, uint32_t i_CurrProc)
+{
+    // Targets are sent one after the other, each one prefixed by its length
+    std::vector<char> packed;
+    auto isValid = 1;
+    if (i_CurrProc == MANAGER_ID)
+    {
+        std::vector<std::string> targets;
+        isValid = loadTargets(i_FileName, targets) ? 1 : 0;
+        for (auto const & target : targets)
+        {
+            packed.push_back(static_cast<char>(std::min<size_t>(target.length(), 255)));
+            packed.insert(packed.end(), target.begin(), target.begin() + std::min<size_t>(target.length(), 255));
+        }
+    }
+
+    MPI_Bcast(&isValid, 1, MPI_INT, MANAGER_ID, MPI_COMM_WORLD);
+    if (!isValid)
+    {
+        return false;
+    }
+
+    auto size = static_cast<int>(packed.size());
+    MPI_Bcast(&size, 1, MPI_INT, MANAGER_ID, MPI_COMM_WORLD);
+    packed.resize(size);
+    MPI_Bcast(packed.data(), size, MPI_CHAR, MANAGER_ID, MPI_COMM_WORLD);
+
+    std::vector<std::string> targets;
+    for (auto pos = 0U; pos < packed.size(); pos += 1 + static_cast<uint8_t>(packed[pos]))
+    {
+        targets.push_back(std::string(&packed[pos + 1], static_cast<uint8_t>(packed[pos])));
+    }
+    g_Targets.reset(new TargetSet(targets));
+    return true;
+}
+
+int main(int argc, char ** argv)
+{
+    // Worker threads never call MPI, only the main thread of each process does
+    auto provided = 0;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Every process reads the same command line
+    std::string mask;
+    for (auto i = 0U; i < LENGTH; ++i)
+    {
+        mask += "?l";
+    }
+    size_t minLength = 0;
+    std::vector<std::string> customCharsets(4);
+    char const * targetsFile = nullptr;
+    auto numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+    auto isUsageValid = true;
+    for (auto i = 1; i < argc; i += 2)
+    {
+        if (i + 1 >= argc)
+        {
+            isUsageValid = false;
+        }
+        else if (strcmp(argv[i], "--mask") == 0)
+        {
+            mask = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "--min-length") == 0)
+        {
+            minLength = strtoul(argv[i + 1], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--targets") == 0)
+        {
+            targetsFile = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "--threads") == 0)
+        {
+            numThreads = std::max(atoi(argv[i + 1]), 1);
+        }
+        else if (argv[i][0] == '-' && argv[i][1] >= '1' && argv[i][1] <= '4' && argv[i][2] == 0)
+        {
+            customCharsets[argv[i][1] - '1'] = argv[i + 1];
+        }
+        else
+        {
+            isUsageValid = false;
+        }
+    }
+
+    runManagerWorkerAlgorithm(argc, argv, [&](uint32_t i_CurrProc, uint32_t i_NumProc)
+    {
+        if (!isUsageValid)
+        {
+            printf("Usage: mpiexec -n PROCESSES %s [--mask MASK] [--min-length LENGTH] [--targets FILE] [--threads COUNT] [-1 CHARSET] ... [-4 CHARSET]\n", argv[0]);
+            return;
+        }
+        if (provided < MPI_THREAD_FUNNELED)
+        {
+            printf("Manager: MPI does not support threads\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        if (targetsFile && !broadcastTargets(targetsFile, i_CurrProc))
+        {
+            printf("Manager: Could not read targets from \"%s\"\n", targetsFile);
+            return;
+        }
+
+        std::unique_ptr<Keyspace> keyspace;
+        try
+        {
+            keyspace.reset(new Keyspace(mask, minLength, customCharsets));
+        }
+        catch (std::invalid_argument const & e)
+        {
+            printf("Manager: Invalid mask \"%s\": %s\n", mask.c_str(), e.what());
+            return;
+        }
+
+        // encode() keeps the length of messages, so only the candidates of LENGTH characters are
+        // tried for a single target. The whole keyspace is tried for a set of targets.
+        auto firstIndex = g_Targets ? 0 : keyspace->getFirstIndex(LENGTH);
+        auto lastIndex  = keyspace->getFirstIndex(g_Targets ? SEARCH_MAX_LENGTH + 1 : LENGTH + 1);
+        printf("Manager: %llu possible solutions for %u processes of %u threads\n",
+            static_cast<unsigned long long>(lastIndex - firstIndex), i_NumProc, numThreads);
+
+        MPI_Comm_dup(MPI_COMM_WORLD, &g_CancelComm);
+        runManager(*keyspace, firstIndex, lastIndex, numThreads, i_NumProc);
+        MPI_Comm_free(&g_CancelComm);
+
+        using namespace std::chrono;
+        printf("Wall Time : %d ms\n", static_cast<int>(duration_cast<milliseconds>(steady_clock::now() - start).count()));
+    },
+    [&](uint32_t i_CurrProc, uint32_t)
+    {
+        if (!isUsageValid || (targetsFile && !broadcastTargets(targetsFile, i_CurrProc)))
+        {
+            return;
+        }
+
+        std::unique_ptr<Keyspace> keyspace;
+        try
+        {
+            keyspace.reset(new Keyspace(mask, minLength, customCharsets));
+        }
+        catch (std::invalid_argument const &)
+        {
+            return;
+        }
+
+        MPI_Comm_dup(MPI_COMM_WORLD, &g_CancelComm);
+        runWorker(*keyspace, numThreads, i_CurrProc);
+        MPI_Comm_free(&g_CancelComm);
+    });
+}
@@ -0,0 +1,149 @@
+#include "../Common/Encode.h"
+#include "../Common/EncodeIndex.h"
+#include "../Common/Keyspace.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Precomputed encode() index: build it once for a keyspace, then recover messages with lookups.
+//
+// Usage: Index build FILE [--mask MASK] [--memory MB] [-1 CHARSET] ... [-4 CHARSET]
+//        Index query FILE [HEX ...]
+//
+// build writes the index of every message of the mask (6 lowercase letters by default, 26^6
+// messages). query looks up encoded messages written in hexadecimal (the encoded message of
+// SOLUTION by default) and prints the messages that encode to them with the lookup time.
+
+// Message looked up when no encoded message is given
+char const SOLUTION[] = "jeremy";
+
+static int printUsage(char const * i_Program)
+{
+    printf("Usage: %s build FILE [--mask MASK] [--memory MB] [-1 CHARSET] ... [-4 CHARSET]\n"
+           "       %s query FILE [HEX ...]\n", i_Program, i_Program);
+    return 1;
+}
+
+static int build(int argc, char ** argv)
+{
+    std::string mask = "?l?l?l?l?l?l";
+    std::vector<std::string> customCharsets(4);
+    uint64_t memoryMB = 256;
+    for (auto i = 3; i < argc; i += 2)
+    {
+        // Every option takes a value
+        if (i + 1 >= argc)
+        {
+            return printUsage(argv[0]);
+        }
+        else if (strcmp(argv[i], "--mask") == 0)
+        {
+            mask = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "--memory") == 0)
+        {
+            memoryMB = std::max(strtoull(argv[i + 1], nullptr, 10), 1ULL);
+        }
+        else if (argv[i][0] == '-' && argv[i][1] >= '1' && argv[i][1] <= '4' && argv[i][2] == 0)
+        {
+            customCharsets[argv[i][1] - '1'] = argv[i + 1];
+        }
+        else
+        {
+            return printUsage(argv[0]);
+        }
+    }
+
+    try
+    {
+        Keyspace keyspace(mask, 0, customCharsets);
+        auto length = keyspace.getMaxLength();
+        printf("Index: %llu messages of %u characters\n",
+            static_cast<unsigned long long>(keyspace.getSize()), static_cast<unsigned int>(length));
+
+        auto start = std::chrono::steady_clock::now();
+        auto onPass = [](uint32_t i_Pass, uint32_t i_NumPasses)
+        {
+            printf("Index: pass %u of %u\n", i_Pass + 1, i_NumPasses);
+        };
+        if (!buildEncodeIndex(keyspace, length, argv[2], (memoryMB << 20) / 16, onPass))
+        {
+            printf("Index: Could not write \"%s\"\n", argv[2]);
+            return 1;
+        }
+
+        using namespace std::chrono;
+        printf("Index: built in %d ms\n", static_cast<int>(duration_cast<milliseconds>(steady_clock::now() - start).count()));
+    }
+    catch (std::invalid_argument const & e)
+    {
+        printf("Index: Invalid mask \"%s\": %s\n", mask.c_str(), e.what());
+        return 1;
+    }
+    return 0;
+}
+
+static int query(int argc, char ** argv)
+{
+    EncodeIndex index;
+    if (!index.open(argv[2]))
+    {
+        printf("Index: Could not read index \"%s\"\n", argv[2]);
+        return 1;
+    }
+
+    // Encoded messages to look up
+    std::vector<std::string> encodedMessages;
+    for (auto i = 3; i < argc; ++i)
+    {
+        std::string hex = argv[i];
+        if (hex.length() % 2 != 0 || hex.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)
+        {
+            printf("Index: \"%s\" is not hexadecimal\n", argv[i]);
+            return 1;
+        }
+        std::string encoded(hex.length() / 2, 0);
+        for (auto j = 0U; j < encoded.length(); ++j)
+        {
+            encoded[j] = static_cast<char>(std::stoi(hex.substr(2 * j, 2), nullptr, 16));
+        }
+        encodedMessages.push_back(encoded);
+    }
+    if (encodedMessages.empty())
+    {
+        encodedMessages.push_back(encode(SOLUTION));
+    }
+
+    for (auto const & encoded : encodedMessages)
+    {
+        using namespace std::chrono;
+        auto start = steady_clock::now();
+        auto messages = index.find(encoded);
+        auto time = duration<double, std::micro>(steady_clock::now() - start).count();
+
+        printf("Index: %u messages in %.1f us:", static_cast<unsigned int>(messages.size()), time);
+        for (auto const & message : messages)
+        {
+            printf(" \"%s\"", message.c_str());
+        }
+        printf("\n");
+    }
+    return 0;
+}
+
+int main(int argc, char ** argv)
+{
+    if (argc >= 3 && strcmp(argv[1], "build") == 0)
+    {
+        return build(argc, argv);
+    }
+    if (argc >= 3 && strcmp(argv[1], "query") == 0)
+    {
+        return query(argc, argv);
+    }
+
+    return printUsage(argv[0]);
+}
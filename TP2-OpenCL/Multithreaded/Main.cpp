@@ -1,120 +1,559 @@
 #include "../Common/Encode.h"
+#include "../Common/InverseSolver.h"
+#include "../Common/Keyspace.h"
+#include "../Common/MappedFile.h"
+#include "../Common/Rules.h"
+#include "../Common/Search.h"
+#include "../Common/TargetSet.h"
 #include "../Common/Time.h"
+#include "../Common/Topology.h"
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <thread>
+#include <vector>
 
 // The word the program looks for
-auto const SOLUTION = "jeremy";
+char const SOLUTION[] = "jeremy";
+
+// Length of the word to decode
+size_t const LENGTH = sizeof(SOLUTION) - 1;
 
 // Encoded message we want to obtain after applying the encoding algorithm on possible solutions
 auto const ENCODED = encode(SOLUTION);
 
-// Length of the word to decode
-auto const LENGTH = ENCODED.length();
+// Largest number of worker threads
+uint32_t const MAX_WORKERS = 1024;
+
+// Number of worker threads performing a brute-force attack on the encoding algorithm: one per
+// processor of the affinity policy, or per logical processor without one, unless --threads is given
+uint32_t g_NumWorkers = 1;
+
+// Number of possible solutions a worker claims at once (a multiple of SEARCH_BATCH_WIDTH)
+unsigned long long const CHUNK_SIZE = 1 << 16;
 
-// Number of worker threads performing a brute-force attack on the encoding algorithm
-auto const NUM_WORKERS = 13U;
+// Largest number of NUMA nodes the work is split between
+uint32_t const MAX_NODES = ChunkScheduler::MAX_PARTITIONS;
 
-// Array of solutions found (one entry per worker thread)
-std::string g_Solutions[NUM_WORKERS];
+// Work still to be claimed by the workers, one partition per NUMA node
+ChunkScheduler g_Scheduler;
 
-// Condition after which the manager thread waits before exiting the program
-std::condition_variable g_SolutionIsFound;
+// Encoded messages looked for with --targets (ENCODED is looked for otherwise)
+std::unique_ptr<TargetSet> g_Targets;
 
-// Code executed by each worker thread (or the main thread if NUM_WORKERS is one)
-void worker(char i_FirstLetter, char i_LastLetter, uint16_t i_ID)
+// Search engine shared by the workers
+std::unique_ptr<KeyspaceSearch> g_Search;
+
+// Number of targets matched so far
+std::atomic<uint64_t> g_NumMatches(0);
+
+// Solution found, so every worker stops after its current chunk
+FoundSolution g_Solution;
+
+// Interval between two progress reports
+auto const REPORT_INTERVAL = std::chrono::seconds(1);
+
+// Counters of a worker thread, sampled by the reporter thread. Each worker has its own cache line.
+// They live in a static array because new ignores alignas before C++17; the pages of the workers
+// not started are never touched.
+struct alignas(64) WorkerStats
 {
-    // Build first possible solution
-    std::string possibleSolution;
-    possibleSolution.resize(LENGTH);
-    for (auto i = 0U; i < LENGTH; ++i)
+    // Possible solutions encoded
+    std::atomic<uint64_t> numTries;
+
+    // Work covered: keyspace indices, or bytes of the wordlist
+    std::atomic<uint64_t> progress;
+};
+WorkerStats g_Stats[MAX_WORKERS];
+
+// Work to cover (keyspace indices, or bytes of the wordlist)
+uint64_t g_TotalProgress = 0;
+
+// Set by the manager thread once workers are done, to stop the reporter thread
+bool g_AreWorkersDone = false;
+std::mutex g_ReportMutex;
+std::condition_variable g_WorkersAreDone;
+
+// Add to a counter of the calling worker. Only this worker writes it, so a relaxed load and store
+// are enough (no locked instruction).
+inline void addToCounter(std::atomic<uint64_t> & io_Counter, uint64_t i_Value)
+{
+    io_Counter.store(io_Counter.load(std::memory_order_relaxed) + i_Value, std::memory_order_relaxed);
+}
+
+// Write the characters of i_Text as hexadecimal in o_Hex (2 * i_Length + 1 characters)
+void toHex(char const * i_Text, size_t i_Length, char * o_Hex)
+{
+    for (auto i = 0U; i < i_Length; ++i)
+    {
+        sprintf(o_Hex + 2 * i, "%02x", static_cast<uint8_t>(i_Text[i]));
+    }
+    o_Hex[2 * i_Length] = 0;
+}
+
+// Report a possible solution whose encoded message is looked for (called by the workers)
+void onFound(uint16_t i_ID, char const * i_Solution, char const * i_Encoded, size_t i_Length)
+{
+    if (g_Targets)
+    {
+        char hex[2 * SEARCH_MAX_LENGTH + 1];
+        toHex(i_Encoded, i_Length, hex);
+        printf("Worker thread %d: FOUND SOLUTION \"%s\" for %s\n", i_ID, i_Solution, hex);
+        g_NumMatches.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        printf("Worker thread %d: FOUND SOLUTION \"%s\"\n", i_ID, i_Solution);
+        g_Solution.report(i_Solution);
+    }
+}
+
+// Code executed by each worker thread (or the main thread if there is only one)
+void worker(Keyspace const & i_Keyspace, uint16_t i_ID)
+{
+    // Claim chunks of possible solutions until all were tried or a solution is found
+    uint64_t first;
+    uint64_t last;
+    while (!g_Solution.isClaimed() && g_Scheduler.claimChunk(i_ID, CHUNK_SIZE, first, last))
+    {
+        addToCounter(g_Stats[i_ID].numTries, g_Search->searchRange(i_Keyspace, first, last, i_ID));
+        addToCounter(g_Stats[i_ID].progress, last - first);
+    }
+}
+
+// Size of the parts of the wordlist claimed by workers
+uint64_t const WORDLIST_CHUNK_SIZE = 1 << 20;
+
+// Wordlist read with --wordlist, and rules applied to each of its words with --rules
+MappedFile g_Wordlist;
+std::vector<Rule> g_Rules;
+
+// Words of one length waiting to be encoded together, stored one after the other
+struct PendingWords
+{
+    char   chars[SEARCH_BATCH_WIDTH * SEARCH_MAX_LENGTH];
+    size_t count;
+};
+
+// Encode the words of i_Length characters of io_Words and empty it. Return true if the single
+// target looked for was found.
+bool flushWords(size_t i_Length, PendingWords & io_Words, uint16_t i_ID)
+{
+    addToCounter(g_Stats[i_ID].numTries, io_Words.count);
+    auto isFound = g_Search->searchWords(io_Words.chars, io_Words.count, i_Length, i_ID);
+    io_Words.count = 0;
+    return isFound;
+}
+
+// Code executed by each worker thread with --wordlist: words are read from the mapped file
+// without copies, grouped by length and encoded by batches
+void wordlistWorker(uint16_t i_ID)
+{
+    std::vector<PendingWords> pending(SEARCH_MAX_LENGTH + 1);
+    for (auto & words : pending)
     {
-        possibleSolution[i] = i_FirstLetter;
+        words.count = 0;
     }
 
-    // Compute the maximum number of tries possible
-    auto maxNumTries = static_cast<unsigned long long>(i_LastLetter - i_FirstLetter + 1);
-    for (auto i = 0U; i < LENGTH - 1; ++i)
+    // Queue a possible solution, and encode its batch once full. Return true if the single target
+    // looked for was found.
+    auto addWord = [&](char const * i_Word, size_t i_Length)
+    {
+        if (!g_Search->isSearched(i_Length))
+        {
+            return false;
+        }
+        auto & words = pending[i_Length];
+        std::copy(i_Word, i_Word + i_Length, words.chars + words.count * i_Length);
+        return ++words.count == SEARCH_BATCH_WIDTH && flushWords(i_Length, words, i_ID);
+    };
+
+    auto data = g_Wordlist.data();
+    auto size = static_cast<uint64_t>(g_Wordlist.size());
+    auto isFound = false;
+    uint64_t first;
+    uint64_t last;
+    while (!isFound && !g_Solution.isClaimed() && g_Scheduler.claimChunk(i_ID, WORDLIST_CHUNK_SIZE, first, last))
     {
-        maxNumTries *= 26;
+        // A part holds the lines starting in it: skip the end of the line started in the previous one
+        auto pos = first;
+        if (pos > 0)
+        {
+            auto newLine = static_cast<char const *>(memchr(data + pos - 1, '\n', size - pos + 1));
+            pos = newLine ? newLine - data + 1 : size;
+        }
+
+        while (!isFound && pos < last)
+        {
+            auto newLine = static_cast<char const *>(memchr(data + pos, '\n', size - pos));
+            auto end = newLine ? newLine - data : size;
+            auto length = end - pos;
+            if (length > 0 && data[end - 1] == '\r')
+            {
+                --length;
+            }
+
+            if (g_Rules.empty())
+            {
+                isFound = addWord(data + pos, length);
+            }
+            for (auto const & rule : g_Rules)
+            {
+                char word[MAX_RULE_OUTPUT];
+                isFound = addWord(word, rule.apply(data + pos, length, word));
+                if (isFound)
+                {
+                    break;
+                }
+            }
+            pos = end + 1;
+        }
+        addToCounter(g_Stats[i_ID].progress, last - first);
     }
 
-    // Number of tries made so far
-    auto numTries = 0LLU;
+    // Encode the words left
+    for (auto length = 1U; length <= SEARCH_MAX_LENGTH && !isFound; ++length)
+    {
+        if (pending[length].count > 0)
+        {
+            isFound = flushWords(length, pending[length], i_ID);
+        }
+    }
+}
+
+// Code executed by the reporter thread: sample the counters of the workers at a fixed interval and
+// print (and write in i_StatsFile if not null) the rate of every worker and of all of them, the
+// work covered and the estimated time left
+void reporter(FILE * i_StatsFile)
+{
+    using namespace std::chrono;
+    auto start = steady_clock::now();
+    auto previousTime = start;
+    std::vector<uint64_t> previousTries(g_NumWorkers, 0);
+
+    if (i_StatsFile)
+    {
+        fprintf(i_StatsFile, "time_s,tries,tries_per_s,coverage,eta_s");
+        for (auto i = 0U; i < g_NumWorkers; ++i)
+        {
+            fprintf(i_StatsFile, ",thread_%u_tries_per_s", i);
+        }
+        fprintf(i_StatsFile, "\n");
+    }
 
-    // Exit when all possible solutions have been tried
-    while (++numTries < maxNumTries)
+    auto isDone = false;
+    while (!isDone)
     {
-        // Log every million tries
-        if (numTries % 1000000 == 0)
         {
-            printf("Worker thread %d: %llu/%llu million tries\n",
-                i_ID, numTries / 1000000, maxNumTries / 1000000);
+            std::unique_lock<std::mutex> lock(g_ReportMutex);
+            isDone = g_WorkersAreDone.wait_for(lock, REPORT_INTERVAL, []() { return g_AreWorkersDone; });
         }
 
-        // Pass the possible solution in the encoder
-        auto encoded = encode(possibleSolution);
+        auto now = steady_clock::now();
+        auto interval = duration<double>(now - previousTime).count();
+        auto elapsed  = duration<double>(now - start).count();
+        previousTime = now;
 
-        // Check the result is what we look for
-        if (encoded == ENCODED)
+        uint64_t numTries = 0;
+        uint64_t progress = 0;
+        std::vector<double> rates(g_NumWorkers);
+        for (auto i = 0U; i < g_NumWorkers; ++i)
         {
-            printf("Worker thread %d: FOUND SOLUTION \"%s\"\n", i_ID, possibleSolution.c_str());
-            g_Solutions[i_ID] = possibleSolution;
-            g_SolutionIsFound.notify_one();
-            return;
+            auto tries = g_Stats[i].numTries.load(std::memory_order_relaxed);
+            rates[i] = interval > 0 ? (tries - previousTries[i]) / interval : 0;
+            previousTries[i] = tries;
+            numTries += tries;
+            progress += g_Stats[i].progress.load(std::memory_order_relaxed);
         }
 
-        // Get next possible solution
-        auto i = LENGTH - 1;
-        while (++possibleSolution[i] == 'z' + 1)
+        // Estimate the time left from the average progress rate
+        auto coverage = g_TotalProgress > 0 ? static_cast<double>(progress) / g_TotalProgress : 1.0;
+        auto eta = progress > 0 ? elapsed * (g_TotalProgress - std::min(progress, g_TotalProgress)) / progress : 0.0;
+        auto rate = 0.0;
+        for (auto threadRate : rates)
         {
-            possibleSolution[i] = 'a';
-            --i;
+            rate += threadRate;
+        }
+
+        printf("Reporter thread: %.2f M tries/s, %.2f%% covered, ETA %.0f s | per thread (M tries/s):",
+            rate / 1e6, 100 * coverage, eta);
+        for (auto threadRate : rates)
+        {
+            printf(" %.2f", threadRate / 1e6);
+        }
+        printf("\n");
+
+        if (i_StatsFile)
+        {
+            fprintf(i_StatsFile, "%.3f,%llu,%.0f,%.6f,%.1f", elapsed, static_cast<unsigned long long>(numTries), rate, coverage, eta);
+            for (auto threadRate : rates)
+            {
+                fprintf(i_StatsFile, ",%.0f", threadRate);
+            }
+            fprintf(i_StatsFile, "\n");
+            fflush(i_StatsFile);
         }
     }
-    printf("Worker thread %d: Could not find any solution\n", i_ID);
 }
 
-int main()
+int main(int argc, char ** argv)
 {
 	// Initial time
 	auto start = std::chrono::steady_clock::now();
 
-    // Run a sequential program if number of worker is 1
-    if (NUM_WORKERS == 1)
+    // Solve the encoding equations instead of trying every possible solution (--solve takes no
+    // other option, so the option loop below rejects it anywhere else)
+    if (argc == 2 && strcmp(argv[1], "--solve") == 0)
+    {
+        for (auto const & solution : solveEncoded(ENCODED))
+        {
+            printf("Solver: FOUND SOLUTION \"%s\"\n", solution.c_str());
+        }
+        using namespace std::chrono;
+        printf("Wall Time : %d ms\n", static_cast<int>(duration_cast<milliseconds>(steady_clock::now() - start).count()));
+        return 0;
+    }
+
+    // Build the keyspace from the mask given on the command line (LENGTH lowercase letters by default)
+    std::string mask;
+    for (auto i = 0U; i < LENGTH; ++i)
+    {
+        mask += "?l";
+    }
+    size_t minLength = 0;
+    std::vector<std::string> customCharsets(4);
+    auto isWordlistMode = false;
+    FILE * statsFile = nullptr;
+    auto affinityPolicy = AffinityPolicy::NONE;
+    auto numWorkers = 0U;
+    auto isUsageValid = true;
+    for (auto i = 1; i < argc && isUsageValid; i += 2)
+    {
+        // Every option takes a value
+        if (i + 1 >= argc)
+        {
+            isUsageValid = false;
+        }
+        else if (strcmp(argv[i], "--mask") == 0)
+        {
+            mask = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "--min-length") == 0)
+        {
+            minLength = strtoul(argv[i + 1], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--targets") == 0)
+        {
+            std::vector<std::string> targets;
+            if (!loadTargets(argv[i + 1], targets))
+            {
+                printf("Manager thread: Could not read targets from \"%s\"\n", argv[i + 1]);
+                return 1;
+            }
+            g_Targets.reset(new TargetSet(targets));
+        }
+        else if (strcmp(argv[i], "--stats") == 0)
+        {
+            statsFile = fopen(argv[i + 1], "w");
+            if (!statsFile)
+            {
+                printf("Manager thread: Could not write statistics to \"%s\"\n", argv[i + 1]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--wordlist") == 0)
+        {
+            if (!g_Wordlist.open(argv[i + 1]))
+            {
+                printf("Manager thread: Could not map wordlist \"%s\"\n", argv[i + 1]);
+                return 1;
+            }
+            isWordlistMode = true;
+        }
+        else if (strcmp(argv[i], "--rules") == 0)
+        {
+            try
+            {
+                g_Rules = loadRules(argv[i + 1]);
+            }
+            catch (std::invalid_argument const & e)
+            {
+                printf("Manager thread: Invalid rules \"%s\": %s\n", argv[i + 1], e.what());
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--affinity") == 0)
+        {
+            if (!parseAffinityPolicy(argv[i + 1], affinityPolicy))
+            {
+                printf("Manager thread: Unknown affinity policy \"%s\" (none, compact, scatter or physical)\n", argv[i + 1]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--threads") == 0)
+        {
+            numWorkers = std::min<uint32_t>(std::max(atoi(argv[i + 1]), 1), MAX_WORKERS);
+        }
+        else if (argv[i][0] == '-' && argv[i][1] >= '1' && argv[i][1] <= '4' && argv[i][2] == 0)
+        {
+            customCharsets[argv[i][1] - '1'] = argv[i + 1];
+        }
+        else
+        {
+            isUsageValid = false;
+        }
+    }
+    if (!isUsageValid)
+    {
+        printf("Usage: %s [--mask MASK] [--min-length LENGTH] [--targets FILE] [--stats FILE] [--affinity POLICY] [--threads COUNT] [-1 CHARSET] ... [-4 CHARSET]\n"
+               "       %s [--wordlist FILE [--rules FILE]] [--targets FILE] [--stats FILE] [--affinity POLICY] [--threads COUNT]\n"
+               "       %s --solve\n", argv[0], argv[0], argv[0]);
+        return 1;
+    }
+
+    std::unique_ptr<Keyspace> keyspace;
+    try
+    {
+        keyspace.reset(new Keyspace(mask, minLength, customCharsets));
+    }
+    catch (std::invalid_argument const & e)
+    {
+        printf("Manager thread: Invalid mask \"%s\": %s\n", mask.c_str(), e.what());
+        return 1;
+    }
+
+    // Processor of each worker, and one partition of the work per NUMA node used. Without --threads,
+    // there is one worker per processor, so workers never share one.
+    auto placement = getThreadPlacement(getCpuTopology(), affinityPolicy);
+    if (numWorkers == 0)
+    {
+        numWorkers = !placement.empty() ? static_cast<uint32_t>(placement.size()) : std::max(std::thread::hardware_concurrency(), 1U);
+    }
+    g_NumWorkers = std::min(numWorkers, MAX_WORKERS);
+    uint32_t partitionOfNode[MAX_NODES];
+    std::fill(partitionOfNode, partitionOfNode + MAX_NODES, MAX_NODES);
+    std::vector<uint32_t> workerPartitions(g_NumWorkers, 0);
+    auto numPartitions = placement.empty() ? 1U : 0U;
+    for (auto i = 0U; i < g_NumWorkers && !placement.empty(); ++i)
+    {
+        auto node = placement[i % placement.size()].node % MAX_NODES;
+        if (partitionOfNode[node] == MAX_NODES)
+        {
+            partitionOfNode[node] = numPartitions++;
+        }
+        workerPartitions[i] = partitionOfNode[node];
+    }
+    if (!placement.empty())
     {
-        worker('a', 'z', 0);
+        printf("Manager thread: %u workers pinned on %u processors of %u NUMA nodes\n",
+            g_NumWorkers, static_cast<unsigned int>(std::min<size_t>(g_NumWorkers, placement.size())), numPartitions);
+    }
+
+    g_Search.reset(new KeyspaceSearch(ENCODED, g_Targets.get(), onFound));
+
+    // Work of each thread: words of the wordlist, or possible solutions of the keyspace
+    std::function<void(uint16_t)> work;
+    if (isWordlistMode)
+    {
+        printf("Manager thread: %llu MB of words with %llu rules\n",
+            static_cast<unsigned long long>(g_Wordlist.size() >> 20),
+            static_cast<unsigned long long>(std::max<size_t>(g_Rules.size(), 1)));
+        g_TotalProgress = g_Wordlist.size();
+        g_Scheduler.reset(0, g_Wordlist.size(), workerPartitions);
+        work = wordlistWorker;
     }
     else
     {
-        // Cannot have more than 26 workers (one per first letter of the solution)
-        if (NUM_WORKERS > 26)
+        // encode() keeps the length of messages, so only the candidates of LENGTH characters are
+        // tried for a single target. The whole keyspace is tried for a set of targets.
+        uint64_t firstIndex;
+        uint64_t lastIndex;
+        if (g_Targets)
+        {
+            firstIndex = 0;
+            lastIndex  = keyspace->getFirstIndex(SEARCH_MAX_LENGTH + 1);
+            printf("Manager thread: %llu possible solutions for %llu targets\n",
+                static_cast<unsigned long long>(lastIndex - firstIndex),
+                static_cast<unsigned long long>(g_Targets->size()));
+        }
+        else
         {
-            printf("Manager thread: Current implementation does not \
-                support more than 26 workers. Ignore extra threads.\n");
+            firstIndex = keyspace->getFirstIndex(LENGTH);
+            lastIndex  = keyspace->getFirstIndex(LENGTH + 1);
+            printf("Manager thread: %llu possible solutions\n",
+                static_cast<unsigned long long>(lastIndex - firstIndex));
         }
-        auto actualNumWorkers = std::min(static_cast<int>(NUM_WORKERS), 26);
+        g_TotalProgress = lastIndex - firstIndex;
+        g_Scheduler.reset(firstIndex, lastIndex, workerPartitions);
+        work = std::bind(worker, std::cref(*keyspace), std::placeholders::_1);
+    }
 
-        // Computes how many letters each thread will have to search through
-        char numLettersPerThread = 26 / actualNumWorkers;
+    // Report progress from a separate thread so workers only update counters
+    std::thread reporterThread(reporter, statsFile);
 
-        // Start worker threads
-        for (auto i = 0; i < actualNumWorkers; ++i)
+    // Pin a worker on its processor before it touches any memory, so its stack and batches are
+    // allocated on its NUMA node
+    auto pinnedWork = [&](uint16_t i_ID)
+    {
+        if (!placement.empty() && !pinCurrentThread(placement[i_ID % placement.size()]))
         {
-            char firstLetter = 'a' +  i      * numLettersPerThread;
-            char lastLetter  = i == actualNumWorkers - 1 ? 'z' :
-                              'a' + (i + 1) * numLettersPerThread - 1;
-            std::thread(worker, firstLetter, lastLetter, i).detach();
+            printf("Worker thread %d: Could not be pinned\n", i_ID);
         }
+        work(i_ID);
+    };
 
-        // Wait for a worker thread to signal that a solution was found
-        std::mutex mutex;
-        std::unique_lock<std::mutex> lock(mutex);
-        g_SolutionIsFound.wait(lock);
+    // Run a sequential program if number of worker is 1
+    if (g_NumWorkers == 1)
+    {
+        pinnedWork(0);
+    }
+    else
+    {
+        // Start worker threads and wait until they ran out of possible solutions or one was found
+        std::vector<std::thread> workers;
+        for (auto i = 0U; i < g_NumWorkers; ++i)
+        {
+            workers.emplace_back(pinnedWork, static_cast<uint16_t>(i));
+        }
+        for (auto & thread : workers)
+        {
+            thread.join();
+        }
+    }
+
+    // Stop the reporter thread (after a last report)
+    {
+        std::lock_guard<std::mutex> lock(g_ReportMutex);
+        g_AreWorkersDone = true;
+    }
+    g_WorkersAreDone.notify_one();
+    reporterThread.join();
+    if (statsFile)
+    {
+        fclose(statsFile);
+    }
+
+    if (g_Targets)
+    {
+        printf("Manager thread: %llu matches\n", static_cast<unsigned long long>(g_NumMatches.load()));
+    }
+    else if (g_Solution.isReady())
+    {
+        printf("Manager thread: Solution is \"%s\"\n", g_Solution.get().c_str());
+    }
+    else
+    {
+        printf("Manager thread: Could not find any solution\n");
     }
 
 	// Print time
 	using namespace std::chrono;
-	printf("Wall Time : %d ms\n", duration_cast<milliseconds>(steady_clock::now() - start).count());
+	printf("Wall Time : %d ms\n", static_cast<int>(duration_cast<milliseconds>(steady_clock::now() - start).count()));
 }
@@ -1,60 +1,333 @@
 #include "OCLWrapper/OCLKernel.h"
+#include "OCLWrapper/OCLProfiler.h"
 #include "OCLWrapper/OCLProgram.h"
+#include "OCLWrapper/OCLStagingBuffer.h"
 #include "Encode.h"
+#include "Keyspace.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
-int main()
+int main(int argc, char ** argv)
 {
     // The word the program looks for
     char const * SOLUTION = "jeremie";
 
     // Used to determine the number of threads to start
     unsigned int const SQRT_NUM_THREADS = 2 << 3;
+    unsigned int const NUM_THREADS = SQRT_NUM_THREADS * SQRT_NUM_THREADS * SQRT_NUM_THREADS;
+
+    // Duration aimed for each batch of the keyspace: long enough to hide the launch overhead, short
+    // enough to stop soon after the solution is found
+    double const TARGET_BATCH_MS = 100.0;
 
     // Length of the word to decode
     unsigned int const MSG_LEN = strlen(SOLUTION);
 
-    // Create OpenCL program (automatically pick first device)
+    // Longest message of the vectorized kernel, and length of its encoded message (padded with 0)
+    unsigned int const MAX_VECTOR_MSG_LEN = 16;
+
+    // Options come first: --vector uses the kernel encoding several candidates at a time in vectors,
+    // --profile FILE prints the time spent in each kernel and transfer and writes them as a Chrome
+    // trace in FILE
+    int firstArg = 1;
+    bool isVector = false;
+    char const * profileFile = NULL;
+    for (; firstArg < argc && strncmp(argv[firstArg], "--", 2) == 0; ++firstArg)
+    {
+        if (strcmp(argv[firstArg], "--vector") == 0)
+        {
+            isVector = true;
+        }
+        else if (strcmp(argv[firstArg], "--profile") == 0 && firstArg + 1 < argc)
+        {
+            profileFile = argv[++firstArg];
+        }
+        else
+        {
+            std::cerr << "Unknown option " << argv[firstArg] << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (isVector && MSG_LEN > MAX_VECTOR_MSG_LEN)
+    {
+        std::cerr << "The vectorized kernel handles messages of at most " << MAX_VECTOR_MSG_LEN << " characters" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Candidates to try: given as a mask (MSG_LEN lowercase letters by default), with up to 4 custom charsets
+    std::string mask;
+    for (unsigned int i = 0; i < MSG_LEN; ++i)
+    {
+        mask += "?l";
+    }
+    if (argc > firstArg)
+    {
+        mask = argv[firstArg];
+    }
+    std::vector<std::string> customCharsets;
+    for (int i = firstArg + 1; i < argc; ++i)
+    {
+        customCharsets.push_back(argv[i]);
+    }
+
+    // Only the candidates of MSG_LEN characters can be encoded as the message
+    unsigned long numCandidates;
+    unsigned int maxCharsetLen = 0;
+    std::vector<char> charsets;
+    std::vector<cl_uint> radices(MSG_LEN, 1);
+    try
+    {
+        Keyspace keyspace(mask, MSG_LEN, customCharsets);
+        if (keyspace.getMaxLength() != MSG_LEN)
+        {
+            throw std::invalid_argument("Mask must describe as many characters as the message");
+        }
+        numCandidates = keyspace.getFirstIndex(MSG_LEN + 1) - keyspace.getFirstIndex(MSG_LEN);
+        for (unsigned int i = 0; i < MSG_LEN; ++i)
+        {
+            radices[i]    = keyspace.getCharset(i).length();
+            maxCharsetLen = std::max(maxCharsetLen, radices[i]);
+        }
+
+        // Charset of each position, every maxCharsetLen characters
+        charsets.resize(MSG_LEN * maxCharsetLen, 0);
+        for (unsigned int i = 0; i < MSG_LEN; ++i)
+        {
+            keyspace.getCharset(i).copy(&charsets[i * maxCharsetLen], maxCharsetLen);
+        }
+    }
+    catch (std::invalid_argument const & e)
+    {
+        std::cerr << "Invalid mask \"" << mask << "\": " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Create OpenCL program on every device
     OCLProgram program;
+    program.SetProfilingEnabled(profileFile != NULL);
 
-    // Compile kernel file
-    if (!program.CreateProgramFromSourceFile("src/Kernel.cl"))
+    // Start compiling the kernel file specialized for this job (or loading it from the binary cache)
+    // while the host is set up
+    program.AddBuildDefine("MSG_LEN",             MSG_LEN);
+    program.AddBuildDefine("MAX_CHARSET_LEN",     maxCharsetLen);
+    program.AddBuildDefine("CUBICRT_NUM_THREADS", SQRT_NUM_THREADS);
+    if (!program.StartProgramFromSourceFile("src/Kernel.cl"))
     {
         std::cerr << "Failed to compile kernel" << std::endl;
         return EXIT_FAILURE;
     }
 
-    // Create kernel function
-    OCLKernel& kernel = *program.CreateKernelFunction("main");
-
     // Create buffers
-    OCLBuffer * encodedMsgBuf = program.CreateBuffer("Encoded message", OCLBuffer::READ_ONLY,  MSG_LEN * sizeof(char));
-    OCLBuffer * solutionsBuf  = program.CreateBuffer("Solutions",       OCLBuffer::WRITE_ONLY, MSG_LEN * sizeof(char));
+    std::string encodedMsg = encode(SOLUTION);
+    encodedMsg.resize(std::max(MSG_LEN, MAX_VECTOR_MSG_LEN), 0);
+    OCLBuffer * encodedMsgBuf = program.CreateBuffer("Encoded message", OCLBuffer::READ_ONLY,  encodedMsg.size() * sizeof(char));
+    OCLBuffer * charsetsBuf   = program.CreateBuffer("Charsets",        OCLBuffer::READ_ONLY,  charsets.size() * sizeof(char),   charsets.data());
+    OCLBuffer * radicesBuf    = program.CreateBuffer("Radices",         OCLBuffer::READ_ONLY,  radices.size()  * sizeof(cl_uint), radices.data());
+
+    // Each device of the context runs its own batches: a queue for the kernel and one for the
+    // transfers, its own found flag and solution (a flag is not shared between devices), and the
+    // batches in flight with their flag in a double-buffered staging area
+    struct DeviceRun
+    {
+        OCLDeviceInfo * device;
+        int kernelQueue;
+        int transferQueue;
+        OCLBuffer * solutionsBuf;
+        OCLBuffer * foundBuf;
+        std::unique_ptr<OCLStagingBuffer> foundStaging;
+        std::vector<unsigned long> slotBatchLen;
+        unsigned long batchSize;
+        unsigned long numTried;
+        int numBatches;
+        int numDone;
+        std::chrono::steady_clock::time_point lastDone;
+    };
+    std::vector<DeviceRun> runs(program.GetContext()->GetNumberOfDevices());
+    for (unsigned int i = 0; i < runs.size(); ++i)
+    {
+        DeviceRun & run = runs[i];
+        cl_int found = 0;
+        run.device        = program.GetContext()->GetDeviceInfo(i);
+        run.kernelQueue   = program.CreateCommandQueue(false, run.device);
+        run.transferQueue = program.CreateCommandQueue(false, run.device);
+        run.solutionsBuf  = program.CreateBuffer(QString("Solutions %1").arg(i), OCLBuffer::WRITE_ONLY, MSG_LEN * sizeof(char));
+        run.foundBuf      = program.CreateBuffer(QString("Found %1").arg(i),     OCLBuffer::READ_WRITE, sizeof(cl_int), &found);
+        run.foundStaging.reset(new OCLStagingBuffer(sizeof(cl_int)));
+        run.slotBatchLen.resize(run.foundStaging->GetSlotCount());
+        run.batchSize  = NUM_THREADS * 64UL;
+        run.numTried   = 0;
+        run.numBatches = 0;
+        run.numDone    = 0;
+        if (run.kernelQueue < 0 || run.transferQueue < 0)
+        {
+            std::cerr << "Failed to create queues of device " << run.device->GetDeviceName().toStdString() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
 
-    // Bind buffers to kernel
+    // Wait for the kernel file to be compiled (for every device)
+    if (!program.WaitForBuild())
+    {
+        std::cerr << "Failed to compile kernel" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Create kernel function
+    OCLKernel& kernel = *program.CreateKernelFunction(isVector ? "mainVector" : "main");
+
+    // Bind shared buffers to kernel (the buffers of the device and the keyspace range are set for each batch)
     if (!kernel.SetArgBuffer(0, encodedMsgBuf) ||
-        !kernel.SetArgBuffer(1, solutionsBuf))
+        !kernel.SetArgBuffer(2, charsetsBuf)   ||
+        !kernel.SetArgBuffer(3, radicesBuf))
     {
         std::cerr << "Failed to bind buffers to kernel" << std::endl;
         return EXIT_FAILURE;
     }
 
-    // Write encoded message in input buffer
-    program.WriteBuffer(encodedMsgBuf, const_cast<char *>(encode(SOLUTION).c_str()));
+    // Write encoded message in input buffer, before any device reads it
+    if (!program.WriteBuffer(encodedMsgBuf, &encodedMsg[0]) || !program.Finish())
+    {
+        std::cerr << "Failed to write input buffer" << std::endl;
+        return EXIT_FAILURE;
+    }
 
-    // Execute kernel
+    // Execute kernel on batches of the keyspace until a thread finds the solution. Every device
+    // takes its next batch from the rest of the keyspace as soon as one of its slots is free, so
+    // the faster devices take more batches. Batches are enqueued ahead: while a device runs one,
+    // the host reads the found flag of the previous one. The first batch of a device gives each
+    // thread a few candidates, the next ones are sized from the time between two flags of the
+    // device (the duration of a batch, the device being kept busy) to take about TARGET_BATCH_MS;
+    // near the end of the keyspace, a batch is at most the share of a device of what is left.
 	size_t globalWorkSize[3] = { SQRT_NUM_THREADS, SQRT_NUM_THREADS, SQRT_NUM_THREADS };
 	size_t localWorkSize [3] = { 8, 8, 8 };
-    if (!program.ExecuteKernel(&kernel, 3, globalWorkSize, localWorkSize))
+    unsigned long numEnqueued = 0;
+    unsigned long numTried = 0;
+    int foundRun = -1;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < runs.size(); ++i)
+    {
+        runs[i].lastDone = start;
+    }
+    while (numTried < numCandidates && foundRun < 0)
+    {
+        bool isWaiting = true;
+        for (unsigned int i = 0; i < runs.size() && foundRun < 0; ++i)
+        {
+            DeviceRun & run = runs[i];
+            int const NUM_SLOTS = run.foundStaging->GetSlotCount();
+
+            // Keep a batch in flight for each slot
+            while (numEnqueued < numCandidates && run.numBatches - run.numDone < NUM_SLOTS)
+            {
+                int slot = run.numBatches % NUM_SLOTS;
+                unsigned long numLeft    = numCandidates - numEnqueued;
+                unsigned long share      = std::max(numLeft / runs.size(), static_cast<unsigned long>(NUM_THREADS));
+                unsigned long batchFirst = numEnqueued;
+                unsigned long batchLen   = std::min(std::min(run.batchSize, share), numLeft);
+                if (!kernel.SetArgBuffer(1, run.solutionsBuf) ||
+                    !kernel.SetArgBuffer(6, run.foundBuf)     ||
+                    !kernel.SetArgULong (4, batchFirst)       ||
+                    !kernel.SetArgULong (5, batchLen))
+                {
+                    std::cerr << "Failed to bind keyspace range to kernel" << std::endl;
+                    return EXIT_FAILURE;
+                }
+
+                // The arguments are those of the enqueue: the next batch can change them right away
+                OCLEvent batchDone = program.EnqueueKernel(&kernel, 3, globalWorkSize, localWorkSize, QList<OCLEvent>(), run.kernelQueue);
+                if (!batchDone.IsValid())
+                {
+                    std::cerr << "Failed to execute kernel" << std::endl;
+                    return EXIT_FAILURE;
+                }
+                QList<OCLEvent> waitList;
+                waitList.append(batchDone);
+                run.foundStaging->SetSlotEvent(slot, program.EnqueueReadBuffer(run.foundBuf, run.foundStaging->GetSlotData(slot), waitList, run.transferQueue));
+                program.Flush(run.kernelQueue);
+                program.Flush(run.transferQueue);
+
+                run.slotBatchLen[slot] = batchLen;
+                numEnqueued += batchLen;
+                ++run.numBatches;
+            }
+
+            // Found flag after the oldest batch in flight of the device, if it is done
+            int slot = run.numDone % NUM_SLOTS;
+            if (run.numDone == run.numBatches || !run.foundStaging->IsSlotReady(slot))
+            {
+                continue;
+            }
+            isWaiting = false;
+            cl_int * foundFlag = static_cast<cl_int *>(run.foundStaging->WaitForSlot(slot));
+            if (!foundFlag)
+            {
+                std::cerr << "Failed to read output buffer" << std::endl;
+                return EXIT_FAILURE;
+            }
+            if (*foundFlag)
+            {
+                foundRun = i;
+            }
+            numTried     += run.slotBatchLen[slot];
+            run.numTried += run.slotBatchLen[slot];
+            ++run.numDone;
+
+            // Size the next batch of the device to the target duration, growing at most 4 times per batch
+            auto now = std::chrono::steady_clock::now();
+            double batchMs = std::chrono::duration<double, std::milli>(now - run.lastDone).count();
+            run.lastDone = now;
+            double scale = batchMs > 0.0 ? std::min(TARGET_BATCH_MS / batchMs, 4.0) : 4.0;
+            run.batchSize = std::max(static_cast<unsigned long>(run.slotBatchLen[slot] * scale), static_cast<unsigned long>(NUM_THREADS));
+
+            std::cout << "Tried " << numTried << " of " << numCandidates << " candidates ("
+                      << 100.0 * numTried / numCandidates << "%)" << std::endl;
+        }
+
+        // No device finished a batch: let them run
+        if (isWaiting && foundRun < 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // Share of the keyspace tried by each device
+    for (unsigned int i = 0; i < runs.size(); ++i)
+    {
+        std::cout << "Device " << runs[i].device->GetDeviceName().toStdString() << ": " << runs[i].numTried
+                  << " candidates, " << runs[i].numTried / totalMs * 1000.0 << " candidates/s" << std::endl;
+    }
+
+    // Profile of the batches, once the last ones are done
+    if (profileFile)
+    {
+        for (int i = 0; i < program.GetCommandQueueCount(); ++i)
+        {
+            program.Finish(i);
+        }
+        std::cout << program.GetProfiler()->GetReport().toStdString();
+        if (!program.GetProfiler()->WriteChromeTrace(profileFile))
+        {
+            std::cerr << "Failed to write profile " << profileFile << std::endl;
+        }
+    }
+
+    if (foundRun < 0)
     {
-        std::cerr << "Failed to execute kernel" << std::endl;
+        std::cout << "No solution found in " << totalMs << " ms" << std::endl;
         return EXIT_FAILURE;
     }
 
-    // Read output buffer
+    // Read output buffer of the device that found the solution (its queue is in order: after its batch)
     char solution[MSG_LEN + 1];
-    if (!program.ReadBuffer(solutionsBuf, solution))
+    if (!program.EnqueueReadBuffer(runs[foundRun].solutionsBuf, solution, QList<OCLEvent>(), runs[foundRun].kernelQueue).Wait())
     {
         std::cerr << "Failed to read output buffer" << std::endl;
         return EXIT_FAILURE;
@@ -62,5 +335,6 @@ int main()
     solution[MSG_LEN] = 0;
 
     // Print solution
-    std::cout << "Solution: " << const_cast<char const *>(solution) << std::endl;
+    std::cout << "Solution: " << const_cast<char const *>(solution) << " found in " << totalMs << " ms by "
+              << runs[foundRun].device->GetDeviceName().toStdString() << std::endl;
 }
@@ -1,18 +1,13 @@
-#define MSG_LEN              7U
-#define ALPHABET_LEN        26U
-#define CUBICRT_NUM_THREADS (2 << 3)
+// The shape of the job is given by the host as build options (-D MSG_LEN=7 ...), so every loop
+// below has constant bounds and each configuration is compiled into unrolled, constant-folded code:
+//  - MSG_LEN: length of the messages
+//  - MAX_CHARSET_LEN: longest charset of a position, distance between charsets in i_Charsets
+//  - CUBICRT_NUM_THREADS: global work size in each of the 3 dimensions
+#if !defined(MSG_LEN) || !defined(MAX_CHARSET_LEN) || !defined(CUBICRT_NUM_THREADS)
+#error "MSG_LEN, MAX_CHARSET_LEN and CUBICRT_NUM_THREADS must be given as build options"
+#endif
 #define NUM_THREADS         (CUBICRT_NUM_THREADS * CUBICRT_NUM_THREADS * CUBICRT_NUM_THREADS)
 
-unsigned long power(unsigned int i_Base, unsigned int i_Exp)
-{
-    unsigned long answer = 1;
-    for (int i = 0; i < i_Exp; ++i)
-    {
-        answer *= i_Base;
-    }
-    return answer;
-}
-
 void add(char * io_ToEncode, int i_Key)
 {
     for (int i = 0; i < MSG_LEN; ++i)
@@ -29,20 +24,17 @@ void xor(char * io_ToEncode, char const * i_Key)
     }
 }
 
+// Rotate right by i_Offset characters
 void shift(char * io_ToEncode, int i_Offset)
 {
-    char temp[2];
-    for (int i = 0; i < i_Offset; ++i)
-    {
-        temp[i] = io_ToEncode[MSG_LEN - 1 - i];
-    }
-    for (int i = MSG_LEN - 1; i >= i_Offset; --i)
+    char temp[MSG_LEN];
+    for (int i = 0; i < MSG_LEN; ++i)
     {
-        io_ToEncode[i] = io_ToEncode[i - i_Offset];
+        temp[(i + i_Offset) % MSG_LEN] = io_ToEncode[i];
     }
-    for (int i = 0; i < i_Offset; ++i)
+    for (int i = 0; i < MSG_LEN; ++i)
     {
-        io_ToEncode[i] = temp[i_Offset - i - 1];
+        io_ToEncode[i] = temp[i];
     }
 }
 
@@ -83,43 +75,76 @@ void encode(char const * i_ToEncode, char * o_Encoded)
     }
 }
 
-__kernel void main(__constant char const * i_EncodedMsg, __global char * o_Solution)
+// Number of candidates a work-item tries between two reads of the found flag
+#define FOUND_CHECK_INTERVAL 1024UL
+
+// Write candidate i_MsgNum in o_Attempt, with the digit of each position in o_Digits
+void setCandidate(ulong i_MsgNum, char * o_Attempt, uint * o_Digits,
+                  __constant char const * i_Charsets, __constant uint const * i_Radices)
 {
-    // Obtain global thread ID
-    unsigned int threadID = get_global_id(0) + get_global_id(1) * CUBICRT_NUM_THREADS + get_global_id(2) * CUBICRT_NUM_THREADS * CUBICRT_NUM_THREADS;
+    for (int i = MSG_LEN - 1; i >= 0; --i)
+    {
+        o_Digits[i]  = (uint)(i_MsgNum % i_Radices[i]);
+        o_Attempt[i] = i_Charsets[i * MAX_CHARSET_LEN + o_Digits[i]];
+        i_MsgNum /= i_Radices[i];
+    }
+}
 
-    // Compute how many message threads will encode
-    unsigned long numPossibilities = power(ALPHABET_LEN, MSG_LEN);
-    unsigned long numTries = numPossibilities / NUM_THREADS;
+// Go to the next candidate
+void nextCandidate(char * io_Attempt, uint * io_Digits,
+                   __constant char const * i_Charsets, __constant uint const * i_Radices)
+{
+    int i = MSG_LEN - 1;
+    while (i >= 0 && ++io_Digits[i] == i_Radices[i])
+    {
+        io_Digits[i]  = 0;
+        io_Attempt[i] = i_Charsets[i * MAX_CHARSET_LEN];
+        --i;
+    }
+    if (i >= 0)
+    {
+        io_Attempt[i] = i_Charsets[i * MAX_CHARSET_LEN + io_Digits[i]];
+    }
+}
 
-    // Compute the first message number to encode
-    unsigned long firstMsgNum = threadID * numTries;
+// One batch of the search: each thread tries an exact range of the candidates
+// [i_FirstIndex, i_FirstIndex + i_NumCandidates) of the messages of MSG_LEN characters. Candidate n
+// is n written in mixed radix: the character at position p is i_Charsets[p * MAX_CHARSET_LEN + digit p],
+// digit p going from 0 to i_Radices[p] - 1 and the last position varying fastest.
+//
+// The thread that finds the message sets io_Found (the first one only writes o_Solution); every
+// thread checks it regularly, so the batch ends soon after the message is found.
+__kernel void main(__constant char const * i_EncodedMsg, __global char * o_Solution,
+                   __constant char const * i_Charsets, __constant uint const * i_Radices,
+                   ulong i_FirstIndex, ulong i_NumCandidates, __global volatile int * io_Found)
+{
+    // Obtain global thread ID
+    unsigned int threadID = get_global_id(0) + get_global_id(1) * CUBICRT_NUM_THREADS + get_global_id(2) * CUBICRT_NUM_THREADS * CUBICRT_NUM_THREADS;
 
-    // Last thread must also do remaining possibilities
-    if (threadID == NUM_THREADS - 1)
+    // Compute how many messages this thread will encode (the first threads do the remaining ones)
+    ulong numTries  = i_NumCandidates / NUM_THREADS;
+    ulong remainder = i_NumCandidates % NUM_THREADS;
+    ulong firstMsgNum = i_FirstIndex + threadID * numTries + min((ulong)threadID, remainder);
+    if (threadID < remainder)
     {
-        numTries += numPossibilities % NUM_THREADS;
+        ++numTries;
     }
 
     // Contains the messages that we try to encode
     char attempt[2 * MSG_LEN];
+    uint digits[MSG_LEN];
 
     // Compute the first message to try
-    for (int i = 0; i < MSG_LEN; ++i)
-    {
-        unsigned long factor = power(ALPHABET_LEN, MSG_LEN - i - 1);
-        char num = (char)(firstMsgNum / factor);
-        attempt[i] = num + 'a';
-        firstMsgNum -= num * factor;
-    }
-
-    // Contains encoded messages
-    //char encodedAttempt[MSG_LEN];
+    setCandidate(firstMsgNum, attempt, digits, i_Charsets, i_Radices);
 
-    // Try all possible solutions
-    unsigned long currTry = 0;
-    while (++currTry < numTries)
+    // Try all possible solutions, until one thread finds the message
+    for (ulong currTry = 0; currTry < numTries; ++currTry)
     {
+        if (currTry % FOUND_CHECK_INTERVAL == 0 && *io_Found)
+        {
+            return;
+        }
+
         // Pass the possible solution in the encoder
         encode(attempt, attempt + MSG_LEN);
 
@@ -135,19 +160,180 @@ __kernel void main(__constant char const * i_EncodedMsg, __global char * o_Solut
         }
         if (isValidSolution)
         {
-            // Copy solution to output buffer
-            for (int i = 0; i < MSG_LEN; ++i)
+            // Copy solution to output buffer if no other thread found one
+            if (atomic_cmpxchg(io_Found, 0, 1) == 0)
             {
-                o_Solution[i] = attempt[i];
+                for (int i = 0; i < MSG_LEN; ++i)
+                {
+                    o_Solution[i] = attempt[i];
+                }
             }
             return;
         }
+
         // Get next possible solution
-        int i = MSG_LEN - 1;
-        while (++attempt[i] == 'z' + 1)
+        nextCandidate(attempt, digits, i_Charsets, i_Radices);
+    }
+}
+
+#if MSG_LEN <= 16
+
+// Vectorized variant: each message is held in a vector (one character per lane, the lanes after
+// MSG_LEN staying 0), the permutations of encode() are shuffle() and add and xor are vector
+// operations. Each thread encodes CANDIDATES_PER_ITEM independent candidates at a time, so their
+// instructions can be interleaved.
+#if MSG_LEN <= 8
+#define VECTOR_WIDTH 8
+typedef uchar8 msgvec;
+#define VLOAD vload8
+#define VSTORE vstore8
+#else
+#define VECTOR_WIDTH 16
+typedef uchar16 msgvec;
+#define VLOAD vload16
+#define VSTORE vstore16
+#endif
+
+#define CANDIDATES_PER_ITEM 4
+
+// Shuffle masks and add steps of encode(), which only depend on MSG_LEN
+typedef struct
+{
+    msgvec shift[3];  // rotate right by 0, 1 and 2
+    msgvec swap[4];   // swap() with keys 1 to 4
+    msgvec steps;     // i in lane i
+} EncodeMasks;
+
+void initEncodeMasks(EncodeMasks * o_Masks)
+{
+    uchar lanes[VECTOR_WIDTH];
+
+    // Lane j of a rotation takes the character i such that j = (i + offset) % MSG_LEN
+    for (int offset = 0; offset < 3; ++offset)
+    {
+        for (int j = 0; j < VECTOR_WIDTH; ++j)
         {
-            attempt[i] = 'a';
-            --i;
+            lanes[j] = j < MSG_LEN ? (j + MSG_LEN - offset % MSG_LEN) % MSG_LEN : j;
         }
+        o_Masks->shift[offset] = VLOAD(0, lanes);
     }
+
+    // Apply the swaps of each key to the lane numbers
+    for (int key = 1; key <= 4; ++key)
+    {
+        for (int j = 0; j < VECTOR_WIDTH; ++j)
+        {
+            lanes[j] = j;
+        }
+        for (int i = 0; i + key < MSG_LEN; ++i)
+        {
+            uchar temp = lanes[i];
+            lanes[i] = lanes[i + key];
+            lanes[i + key] = temp;
+        }
+        o_Masks->swap[key - 1] = VLOAD(0, lanes);
+    }
+
+    for (int j = 0; j < VECTOR_WIDTH; ++j)
+    {
+        lanes[j] = j < MSG_LEN ? j : 0;
+    }
+    o_Masks->steps = VLOAD(0, lanes);
+}
+
+// Same as getKey(): the sum of the characters modulo 4 does not depend on their sign
+uint getKeyVector(msgvec i_ToEncode)
+{
+#if VECTOR_WIDTH == 16
+    ushort8 sum8 = convert_ushort8(i_ToEncode.lo) + convert_ushort8(i_ToEncode.hi);
+#else
+    ushort8 sum8 = convert_ushort8(i_ToEncode);
+#endif
+    ushort4 sum4 = sum8.lo + sum8.hi;
+    ushort2 sum2 = sum4.lo + sum4.hi;
+    return (sum2.s0 + sum2.s1) % 4 + 1;
 }
+
+msgvec encodeVector(msgvec i_ToEncode, EncodeMasks const * i_Masks)
+{
+    msgvec encoded = i_ToEncode;
+    for (int i = 0; i < 3; ++i)
+    {
+        uint key = getKeyVector(encoded);
+        encoded  = shuffle(encoded, i_Masks->shift[key / 2]);
+        encoded += (uchar)key * i_Masks->steps;
+        encoded  = shuffle(encoded, i_Masks->swap[key - 1]);
+        encoded ^= i_ToEncode;
+    }
+    return encoded;
+}
+
+// Same search as main(), i_EncodedMsg holding VECTOR_WIDTH characters (padded with 0)
+__kernel void mainVector(__constant uchar const * i_EncodedMsg, __global char * o_Solution,
+                         __constant char const * i_Charsets, __constant uint const * i_Radices,
+                         ulong i_FirstIndex, ulong i_NumCandidates, __global volatile int * io_Found)
+{
+    // Obtain global thread ID
+    unsigned int threadID = get_global_id(0) + get_global_id(1) * CUBICRT_NUM_THREADS + get_global_id(2) * CUBICRT_NUM_THREADS * CUBICRT_NUM_THREADS;
+
+    // Compute how many messages this thread will encode (the first threads do the remaining ones)
+    ulong numTries  = i_NumCandidates / NUM_THREADS;
+    ulong remainder = i_NumCandidates % NUM_THREADS;
+    ulong firstMsgNum = i_FirstIndex + threadID * numTries + min((ulong)threadID, remainder);
+    if (threadID < remainder)
+    {
+        ++numTries;
+    }
+
+    EncodeMasks masks;
+    initEncodeMasks(&masks);
+    msgvec target = VLOAD(0, i_EncodedMsg);
+
+    // Next message to try, padded with 0 up to the vector width
+    char attempt[VECTOR_WIDTH] = { 0 };
+    uint digits[MSG_LEN];
+    setCandidate(firstMsgNum, attempt, digits, i_Charsets, i_Radices);
+
+    // Try all possible solutions, CANDIDATES_PER_ITEM at a time, until one thread finds the message
+    for (ulong currTry = 0; currTry < numTries; currTry += CANDIDATES_PER_ITEM)
+    {
+        if (currTry % FOUND_CHECK_INTERVAL == 0 && *io_Found)
+        {
+            return;
+        }
+
+        msgvec candidates[CANDIDATES_PER_ITEM];
+        for (int c = 0; c < CANDIDATES_PER_ITEM; ++c)
+        {
+            candidates[c] = VLOAD(0, (uchar const *)attempt);
+            nextCandidate(attempt, digits, i_Charsets, i_Radices);
+        }
+
+        msgvec encoded[CANDIDATES_PER_ITEM];
+        for (int c = 0; c < CANDIDATES_PER_ITEM; ++c)
+        {
+            encoded[c] = encodeVector(candidates[c], &masks);
+        }
+
+        // The last group can go past the range of the thread
+        for (int c = 0; c < CANDIDATES_PER_ITEM; ++c)
+        {
+            if (currTry + c < numTries && all(encoded[c] == target))
+            {
+                // Copy solution to output buffer if no other thread found one
+                if (atomic_cmpxchg(io_Found, 0, 1) == 0)
+                {
+                    uchar solution[VECTOR_WIDTH];
+                    VSTORE(candidates[c], 0, solution);
+                    for (int i = 0; i < MSG_LEN; ++i)
+                    {
+                        o_Solution[i] = solution[i];
+                    }
+                }
+                return;
+            }
+        }
+    }
+}
+
+#endif
@@ -12,6 +12,16 @@ OCLDeviceInfo::OCLDeviceInfo(OCLPlatformInfo* owner, cl_device_id deviceID)
 	clGetDeviceInfo(m_deviceID, CL_DEVICE_NAME, nameSize, name, 0);
 	m_deviceName = QString(name);
 	delete[] name;
+	clGetDeviceInfo(m_deviceID, CL_DEVICE_VERSION, 0, 0, &nameSize);
+	name = new char[nameSize];
+	clGetDeviceInfo(m_deviceID, CL_DEVICE_VERSION, nameSize, name, 0);
+	m_deviceVersion = QString(name);
+	delete[] name;
+	clGetDeviceInfo(m_deviceID, CL_DRIVER_VERSION, 0, 0, &nameSize);
+	name = new char[nameSize];
+	clGetDeviceInfo(m_deviceID, CL_DRIVER_VERSION, nameSize, name, 0);
+	m_driverVersion = QString(name);
+	delete[] name;
 	clGetDeviceInfo(m_deviceID, CL_DEVICE_TYPE, sizeof(cl_device_type), &m_deviceType, 0);
 	clGetDeviceInfo(m_deviceID, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(uint), &m_computeUnits, 0);
 	clGetDeviceInfo(m_deviceID, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(size_t), &m_maxWorkGroupSize, 0);
@@ -13,6 +13,8 @@ public:
 
     OCLPlatformInfo* GetPlatformOwner() const { return m_platformOwner; }
 	QString GetDeviceName() const { return m_deviceName; }
+	QString GetDeviceVersion() const { return m_deviceVersion; }
+	QString GetDriverVersion() const { return m_driverVersion; }
 	uint GetComputeUnits() const { return m_computeUnits; }
 	size_t GetMaxWorkGroupSize() const { return m_maxWorkGroupSize; }
 	uint GetMaxWorkItemDimensions() const { return m_maxWorkItemDimensions; }
@@ -30,6 +32,8 @@ private:
     OCLPlatformInfo* m_platformOwner;
 	cl_device_id m_deviceID;
 	QString m_deviceName;
+	QString m_deviceVersion;
+	QString m_driverVersion;
 	uint m_computeUnits;
 	size_t m_maxWorkGroupSize;
 	uint m_maxWorkItemDimensions;
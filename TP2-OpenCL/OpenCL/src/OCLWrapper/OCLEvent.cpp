@@ -0,0 +1,59 @@
+#include "OCLEvent.h"
+
+#include <QDebug>
+
+OCLEvent::OCLEvent()
+: m_innerEvent(NULL)
+{
+}
+
+// Take ownership of an event returned by an enqueue
+OCLEvent::OCLEvent(cl_event event)
+: m_innerEvent(event)
+{
+}
+
+OCLEvent::OCLEvent(const OCLEvent& other)
+: m_innerEvent(other.m_innerEvent)
+{
+    if(m_innerEvent)
+        clRetainEvent(m_innerEvent);
+}
+
+OCLEvent& OCLEvent::operator=(const OCLEvent& other)
+{
+    if(other.m_innerEvent)
+        clRetainEvent(other.m_innerEvent);
+    if(m_innerEvent)
+        clReleaseEvent(m_innerEvent);
+    m_innerEvent = other.m_innerEvent;
+    return *this;
+}
+
+OCLEvent::~OCLEvent()
+{
+    if(m_innerEvent && clReleaseEvent(m_innerEvent) != CL_SUCCESS)
+        qDebug()<<"Error in deleting event object.";
+}
+
+bool OCLEvent::IsComplete() const
+{
+    if(!m_innerEvent)
+        return true;
+    // A failed query is reported as a completed command, Wait() then reports the error
+    cl_int status = CL_COMPLETE;
+    if(clGetEventInfo(m_innerEvent, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(status), &status, 0) != CL_SUCCESS)
+        return true;
+    return status <= CL_COMPLETE;
+}
+
+// Wait for the command, return false if it failed
+bool OCLEvent::Wait() const
+{
+    if(!m_innerEvent)
+        return false;
+    cl_int status = CL_COMPLETE;
+    cl_int errNo = clWaitForEvents(1, &m_innerEvent);
+    errNo |= clGetEventInfo(m_innerEvent, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(status), &status, 0);
+    return errNo == CL_SUCCESS && status == CL_COMPLETE;
+}
@@ -0,0 +1,33 @@
+#ifndef _OCL_EVENT_H_
+#define _OCL_EVENT_H_
+
+#include <CL/opencl.h>
+
+class OCLProgram;
+
+// Handle on an enqueued command, to wait for it or to make other commands wait for it.
+// Copies share the same OpenCL event.
+class OCLEvent
+{
+public:
+    OCLEvent();
+    OCLEvent(const OCLEvent& other);
+    OCLEvent& operator=(const OCLEvent& other);
+    ~OCLEvent();
+
+    // An event that is not valid is the one of a command that could not be enqueued
+    bool IsValid() const { return m_innerEvent != NULL; }
+    bool IsComplete() const;
+    bool Wait() const;
+
+private:
+    explicit OCLEvent(cl_event event);
+    cl_event GetInnerEvent() const { return m_innerEvent; }
+
+    cl_event m_innerEvent;
+
+    friend class OCLProgram;
+    friend class OCLProfiler;
+};
+
+#endif //_OCL_EVENT_H_
@@ -0,0 +1,172 @@
+#include "OCLProfiler.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QMap>
+#include <QTextStream>
+
+// Number of commands recorded between two collections of the complete ones
+static const int COLLECT_INTERVAL = 64;
+
+// Statistics of the commands with the same label
+struct CommandStats
+{
+    int count;
+    double totalMs;
+    double minMs;
+    double maxMs;
+    double delayMs;
+    double bytes;
+};
+
+OCLProfiler::OCLProfiler()
+: m_firstPending(0)
+{
+}
+
+void OCLProfiler::Record(const OCLEvent& event, CommandType type, const QString& name, size_t bytes, int queue)
+{
+    if(!event.IsValid())
+        return;
+    Command command;
+    command.event = event;
+    command.type = type;
+    command.name = name;
+    command.bytes = bytes;
+    command.queue = queue;
+    command.isCollected = false;
+    command.queued = command.submit = command.start = command.end = 0;
+    m_commands.append(command);
+    if(m_commands.size() % COLLECT_INTERVAL == 0)
+        Collect();
+}
+
+void OCLProfiler::Clear()
+{
+    m_commands.clear();
+    m_firstPending = 0;
+}
+
+// Read the timestamps of the commands that completed since the last call, and release their event
+void OCLProfiler::Collect()
+{
+    for(int i = m_firstPending; i < m_commands.size(); ++i)
+    {
+        Command& command = m_commands[i];
+        if(command.isCollected || !command.event.IsComplete())
+            continue;
+        cl_event event = command.event.GetInnerEvent();
+        cl_int errNo = clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_QUEUED, sizeof(cl_ulong), &command.queued, 0);
+        errNo |= clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_SUBMIT, sizeof(cl_ulong), &command.submit, 0);
+        errNo |= clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &command.start, 0);
+        errNo |= clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &command.end, 0);
+        if(errNo != CL_SUCCESS)
+            qDebug()<<"Error on reading profiling info of"<<GetLabel(command);
+        command.isCollected = true;
+        command.event = OCLEvent();
+    }
+    while(m_firstPending < m_commands.size() && m_commands[m_firstPending].isCollected)
+        ++m_firstPending;
+}
+
+QString OCLProfiler::GetLabel(const Command& command)
+{
+    switch(command.type)
+    {
+    case READ_BUFFER:
+        return "read " + command.name;
+    case WRITE_BUFFER:
+        return "write " + command.name;
+    default:
+        return command.name;
+    }
+}
+
+// Statistics of the complete commands, per kernel and per buffer transfer, times in milliseconds
+QString OCLProfiler::GetReport()
+{
+    Collect();
+
+    QMap<QString, CommandStats> statsByLabel;
+    for(int i = 0; i < m_commands.size(); ++i)
+    {
+        const Command& command = m_commands[i];
+        if(!command.isCollected)
+            continue;
+        double ms = (command.end - command.start) * 1e-6;
+        double delayMs = (command.start - command.queued) * 1e-6;
+        QString label = GetLabel(command);
+        if(!statsByLabel.contains(label))
+        {
+            CommandStats stats = { 0, 0.0, ms, ms, 0.0, 0.0 };
+            statsByLabel.insert(label, stats);
+        }
+        CommandStats& stats = statsByLabel[label];
+        ++stats.count;
+        stats.totalMs += ms;
+        stats.minMs = qMin(stats.minMs, ms);
+        stats.maxMs = qMax(stats.maxMs, ms);
+        stats.delayMs += delayMs;
+        stats.bytes += command.bytes;
+    }
+
+    QString report;
+    QTextStream stream(&report);
+    stream << qSetFieldWidth(24) << left << "Command" << qSetFieldWidth(10) << right
+           << "Count" << "Total ms" << "Avg ms" << "Min ms" << "Max ms" << "Delay ms" << "GB/s" << qSetFieldWidth(0) << "\n";
+    for(QMap<QString, CommandStats>::Iterator it = statsByLabel.begin(); it != statsByLabel.end(); ++it)
+    {
+        const CommandStats& stats = it.value();
+        stream << qSetFieldWidth(24) << left << it.key() << qSetFieldWidth(10) << right << fixed << qSetRealNumberPrecision(3)
+               << stats.count << stats.totalMs << stats.totalMs / stats.count << stats.minMs << stats.maxMs
+               << stats.delayMs / stats.count;
+        if(stats.bytes > 0 && stats.totalMs > 0)
+            stream << stats.bytes / (stats.totalMs * 1e6);
+        else
+            stream << "-";
+        stream << qSetFieldWidth(0) << "\n";
+    }
+    stream.flush();
+    return report;
+}
+
+// Write the complete commands in the Chrome trace event format (chrome://tracing), one row per queue
+bool OCLProfiler::WriteChromeTrace(const QString& fileName)
+{
+    Collect();
+
+    QFile file(fileName);
+    if(!file.open(QFile::WriteOnly | QFile::Truncate))
+        return false;
+
+    // Timestamps from the first enqueued command, in microseconds
+    cl_ulong origin = 0;
+    for(int i = 0; i < m_commands.size(); ++i)
+    {
+        if(m_commands[i].isCollected && (origin == 0 || m_commands[i].queued < origin))
+            origin = m_commands[i].queued;
+    }
+
+    QTextStream stream(&file);
+    stream << "{\"traceEvents\":[";
+    bool isFirst = true;
+    for(int i = 0; i < m_commands.size(); ++i)
+    {
+        const Command& command = m_commands[i];
+        if(!command.isCollected)
+            continue;
+        QString label = GetLabel(command).replace("\\", "\\\\").replace("\"", "\\\"");
+        stream << (isFirst ? "\n" : ",\n")
+               << "{\"name\":\"" << label << "\",\"cat\":\"" << (command.type == KERNEL ? "kernel" : "transfer")
+               << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << command.queue
+               << ",\"ts\":" << QString::number((command.start - origin) / 1000.0, 'f', 3)
+               << ",\"dur\":" << QString::number((command.end - command.start) / 1000.0, 'f', 3)
+               << ",\"args\":{\"bytes\":" << QString::number((qulonglong)command.bytes)
+               << ",\"queue_delay_us\":" << QString::number((command.start - command.queued) / 1000.0, 'f', 3) << "}}";
+        isFirst = false;
+    }
+    stream << "\n]}\n";
+    stream.flush();
+    file.close();
+    return true;
+}
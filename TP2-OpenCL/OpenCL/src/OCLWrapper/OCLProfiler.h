@@ -0,0 +1,57 @@
+#ifndef _OCL_PROFILER_H_
+#define _OCL_PROFILER_H_
+
+#include "OCLEvent.h"
+
+#include <CL/opencl.h>
+#include <QList>
+#include <QString>
+
+// Timestamps of the commands enqueued by a program with profiling enabled, with statistics per
+// kernel and per buffer transfer:
+//  - queue delay: from the enqueue to the start on the device (launch overhead)
+//  - time: from the start to the end on the device (compute or copy)
+//  - bandwidth of the transfers
+class OCLProfiler
+{
+public:
+    enum CommandType { KERNEL, READ_BUFFER, WRITE_BUFFER };
+
+    OCLProfiler();
+
+    // Record a command, its timestamps are read once it is complete. Complete commands are
+    // collected regularly, so their events are released during long runs.
+    void Record(const OCLEvent& event, CommandType type, const QString& name, size_t bytes, int queue);
+    void Clear();
+
+    int GetCommandCount() const { return m_commands.size(); }
+    QString GetReport();
+    bool WriteChromeTrace(const QString& fileName);
+
+private:
+    struct Command
+    {
+        OCLEvent event;
+        CommandType type;
+        QString name;
+        size_t bytes;
+        int queue;
+        bool isCollected;
+        cl_ulong queued;
+        cl_ulong submit;
+        cl_ulong start;
+        cl_ulong end;
+    };
+
+    void Collect();
+    static QString GetLabel(const Command& command);
+
+    OCLProfiler(const OCLProfiler&);
+    OCLProfiler& operator=(const OCLProfiler&);
+
+    QList<Command> m_commands;
+    // Commands before this index are all collected
+    int m_firstPending;
+};
+
+#endif //_OCL_PROFILER_H_
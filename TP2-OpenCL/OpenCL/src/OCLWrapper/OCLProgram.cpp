@@ -1,31 +1,50 @@
 #include "OCLProgram.h"
 #include "OCLKernel.h"
+#include "OCLProfiler.h"
 
+#include <QCryptographicHash>
+#include <QDataStream>
 #include <QDebug>
+#include <QDir>
 #include <QFile>
 #include <QString>
 #include <QTextStream>
 
+#include <cstring>
+
+// First word of a binary cache file
+static const quint32 BINARY_CACHE_MAGIC = 0x4F434C42;
+
 // Create a new program in a new context
 OCLProgram::OCLProgram()
 : m_oclInnerProgram(NULL)
+, m_binaryCacheDirectory(QDir(QDir::tempPath()).filePath("OCLProgramCache"))
+, m_buildFinished(true)
+, m_profiler(NULL)
 {
     m_context = new OCLContext();
-    m_commandQueue = clCreateCommandQueue(m_context->GetInnerContext(), m_context->GetDevicesID()[0], 0, 0);
+    CreateCommandQueue();
 }
 
 // Create a new program in an existing context
 OCLProgram::OCLProgram(OCLContext* context)
 : m_context(context)
 , m_oclInnerProgram(NULL)
+, m_binaryCacheDirectory(QDir(QDir::tempPath()).filePath("OCLProgramCache"))
+, m_buildFinished(true)
+, m_profiler(NULL)
 {
-    m_commandQueue = clCreateCommandQueue(context->GetInnerContext(), context->GetDevicesID()[0], 0, 0);
+    CreateCommandQueue();
 }
 
 // Destroy the current program
 OCLProgram::~OCLProgram(void)
 {
-    clFinish(m_commandQueue);
+    for(int i = 0; i < m_commandQueues.size(); ++i)
+    {
+        clFinish(m_commandQueues[i]);
+    }
+    WaitForBuild();
 
     QHash<QString, OCLKernel*>::Iterator it = m_kernels.begin();
     for(; it != m_kernels.end(); ++it)
@@ -40,14 +59,21 @@ OCLProgram::~OCLProgram(void)
     }
     m_buffers.clear();
 
-    if(m_oclInnerProgram)
+    for(QHash<QString, cl_program>::Iterator it = m_programs.begin(); it != m_programs.end(); ++it)
     {
-        if(clReleaseProgram(m_oclInnerProgram) != CL_SUCCESS)
+        if(clReleaseProgram(it.value()) != CL_SUCCESS)
             qDebug()<<"Error on deleting program.";
     }
+    m_programs.clear();
 
-    if(clReleaseCommandQueue(m_commandQueue) != CL_SUCCESS)
-        qDebug()<<"Error on deleting command queue.";
+    // Events of the profiler refer to the queues
+    delete m_profiler;
+
+    for(int i = 0; i < m_commandQueues.size(); ++i)
+    {
+        if(clReleaseCommandQueue(m_commandQueues[i]) != CL_SUCCESS)
+            qDebug()<<"Error on deleting command queue.";
+    }
 
     delete m_context;
 }
@@ -84,28 +110,59 @@ bool OCLProgram::AddProgramSourceFromSourceCode(const char** sourceCode, int sou
     return true;
 }
 
+// Add a -D option to the build options
+void OCLProgram::AddBuildDefine(const QString& name, const QString& value)
+{
+    if(!m_buildOptions.isEmpty())
+        m_buildOptions.append(" ");
+    m_buildOptions.append("-D " + name + "=" + value);
+}
+
+void OCLProgram::AddBuildDefine(const QString& name, unsigned long value)
+{
+    AddBuildDefine(name, QString::number(value));
+}
+
 // Create the program from all the added parts
 bool OCLProgram::CreateProgramWithAddedSources()
 {
-    cl_int errNo;
+    QList<QByteArray> codes;
     const char** sources = new const char*[m_programsCode.size()];
     for(int i = 0; i < m_programsCode.size() ; ++i)
     {
-        QByteArray code = m_programsCode[i].toAscii();
-        sources[i] = code.data();
+        codes.append(m_programsCode[i].toAscii());
+        sources[i] = codes[i].data();
     }
-    qDebug()<<"Compiling OpenCL program...";
-    m_oclInnerProgram = clCreateProgramWithSource(m_context->GetInnerContext(), m_programsCode.size(), sources, 0, &errNo);
-    errNo |= clBuildProgram(m_oclInnerProgram, 0, 0, 0, 0, 0);
-    if(errNo != CL_SUCCESS)
-        qDebug()<<"Error while compiling OpenCL program :\n"<<GetBuildInfos();
-    else
-        qDebug()<<"Compile successfully completed. No error found.";
-    return errNo == CL_SUCCESS;
+    bool success = StartProgramFromSourceCode(sources, m_programsCode.size()) && WaitForBuild();
+    delete[] sources;
+    return success;
 }
 
 // Create the program from the specified file
 bool OCLProgram::CreateProgramFromSourceFile(QString fileName)
+{
+    return StartProgramFromSourceFile(fileName) && WaitForBuild();
+}
+
+// Create the program from the specified code
+bool OCLProgram::CreateProgramFromSourceCode(const QString& sourceCode)
+{
+    m_programsCode.append(sourceCode);
+    QByteArray code = sourceCode.toAscii();
+    const char* source = code.data();
+    return StartProgramFromSourceCode(&source, 1) && WaitForBuild();
+}
+
+// Create the program from the specified code. The code can contains more than one file.
+bool OCLProgram::CreateProgramFromSourceCode(const char** sourceCode, int sourceCount)
+{
+    for(int i = 0; i < sourceCount; ++i)
+        m_programsCode.append(QString(sourceCode[i]));
+    return StartProgramFromSourceCode(sourceCode, sourceCount) && WaitForBuild();
+}
+
+// Start building the program from the specified file
+bool OCLProgram::StartProgramFromSourceFile(QString fileName)
 {
     bool success = false;
     QFile openCLFile(fileName);
@@ -115,43 +172,214 @@ bool OCLProgram::CreateProgramFromSourceFile(QString fileName)
         QString ocl = openCLStream.readAll();
         QByteArray code = ocl.toAscii();
         const char* sourceCode = code.data();
-        success = CreateProgramFromSourceCode(&sourceCode, 1);
+        success = StartProgramFromSourceCode(&sourceCode, 1);
         openCLFile.close();
     }
     return success;
 }
 
-// Create the program from the specified code
-bool OCLProgram::CreateProgramFromSourceCode(const QString& sourceCode)
+// Start building the program from the specified code with the current build options. A variant
+// already built by this program is reused as is. Otherwise it is loaded from the binary cache when
+// it was already compiled with the same options for the same devices and drivers, or compiled from
+// source and OnBuildFinished is called by the OpenCL runtime when it is done.
+bool OCLProgram::StartProgramFromSourceCode(const char** sourceCode, int sourceCount)
 {
+    // One build at a time
+    WaitForBuild();
+
+    m_currentProgramKey = GetProgramKey(sourceCode, sourceCount);
+    m_oclInnerProgram = m_programs.value(m_currentProgramKey, NULL);
+    if(m_oclInnerProgram)
+        return true;
+    m_buildFinished = false;
+    m_pendingBinaryCacheFile.clear();
+
+    QString cacheFileName;
+    if(!m_binaryCacheDirectory.isEmpty())
+        cacheFileName = QDir(m_binaryCacheDirectory).filePath(m_currentProgramKey + ".bin");
+    if(!cacheFileName.isEmpty() && LoadProgramBinaries(cacheFileName))
+    {
+        qDebug()<<"OpenCL program loaded from"<<cacheFileName;
+        m_programs.insert(m_currentProgramKey, m_oclInnerProgram);
+        m_buildFinished = true;
+        return true;
+    }
+
     cl_int errNo;
-    m_programsCode.append(sourceCode);
-    QByteArray code = sourceCode.toAscii();
-    const char* source = code.data();
     qDebug()<<"Compiling OpenCL program...";
-    m_oclInnerProgram = clCreateProgramWithSource(m_context->GetInnerContext(), 1, &source, 0, &errNo);
-    errNo |= clBuildProgram(m_oclInnerProgram, 0, 0, 0, 0, 0);
+    m_oclInnerProgram = clCreateProgramWithSource(m_context->GetInnerContext(), sourceCount, sourceCode, 0, &errNo);
     if(errNo != CL_SUCCESS)
-        qDebug() <<"Error while compiling OpenCL program :\n"<<GetBuildInfos();
-    else
-        qDebug()<<"Compile successfully completed. No error found.";
-    return errNo == CL_SUCCESS;
+    {
+        qDebug()<<"Error while creating OpenCL program :"<<errNo;
+        m_oclInnerProgram = NULL;
+        m_buildFinished = true;
+        return false;
+    }
+    m_programs.insert(m_currentProgramKey, m_oclInnerProgram);
+    m_pendingBinaryCacheFile = cacheFileName;
+
+    // The callback can be called before clBuildProgram returns, or never if the build cannot start
+    QByteArray options = m_buildOptions.toAscii();
+    errNo = clBuildProgram(m_oclInnerProgram, 0, 0, options.data(), &OCLProgram::OnBuildFinished, this);
+    if(errNo != CL_SUCCESS)
+    {
+        m_buildMutex.lock();
+        m_buildFinished = true;
+        m_buildMutex.unlock();
+    }
+    return errNo == CL_SUCCESS || errNo == CL_BUILD_PROGRAM_FAILURE;
 }
 
-// Create the program from the specified code. The code can contains more than one file.
-bool OCLProgram::CreateProgramFromSourceCode(const char** sourceCode, int sourceCount)
+void CL_CALLBACK OCLProgram::OnBuildFinished(cl_program, void* userData)
 {
-    cl_int errNo;
+    OCLProgram* program = static_cast<OCLProgram*>(userData);
+    program->m_buildMutex.lock();
+    program->m_buildFinished = true;
+    program->m_buildFinishedCondition.wakeAll();
+    program->m_buildMutex.unlock();
+}
+
+// Whether the build started by StartProgramFromSourceCode is finished
+bool OCLProgram::IsBuildFinished()
+{
+    QMutexLocker locker(&m_buildMutex);
+    return m_buildFinished;
+}
+
+// Wait for the build started by StartProgramFromSourceCode, return true if it succeeded on every device
+bool OCLProgram::WaitForBuild()
+{
+    m_buildMutex.lock();
+    while(!m_buildFinished)
+        m_buildFinishedCondition.wait(&m_buildMutex);
+    m_buildMutex.unlock();
+
+    if(!m_oclInnerProgram)
+        return false;
+
+    bool success = true;
+    for(unsigned int i = 0; i < m_context->GetNumberOfDevices(); ++i)
+    {
+        cl_build_status status = CL_BUILD_ERROR;
+        clGetProgramBuildInfo(m_oclInnerProgram, m_context->GetDevicesID()[i], CL_PROGRAM_BUILD_STATUS, sizeof(status), &status, 0);
+        success &= status == CL_BUILD_SUCCESS;
+    }
+
+    if(!m_pendingBinaryCacheFile.isEmpty())
+    {
+        if(!success)
+            qDebug()<<"Error while compiling OpenCL program :\n"<<GetBuildInfos();
+        else
+        {
+            qDebug()<<"Compile successfully completed. No error found.";
+            if(!SaveProgramBinaries(m_pendingBinaryCacheFile))
+                qDebug()<<"Error on writing OpenCL program cache"<<m_pendingBinaryCacheFile;
+        }
+        m_pendingBinaryCacheFile.clear();
+    }
+    return success;
+}
+
+// Key of a program variant, also the name of its cache file: hash of its code, the build options and
+// every device with its driver
+QString OCLProgram::GetProgramKey(const char** sourceCode, int sourceCount) const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
     for(int i = 0; i < sourceCount; ++i)
-        m_programsCode.append(QString(sourceCode[i]));
-    qDebug()<<"Compiling OpenCL program...";
-    m_oclInnerProgram = clCreateProgramWithSource(m_context->GetInnerContext(), sourceCount, sourceCode, 0, &errNo);
-    errNo |= clBuildProgram(m_oclInnerProgram, 0, 0, 0, 0, 0);
+    {
+        hash.addData(sourceCode[i], strlen(sourceCode[i]) + 1);
+    }
+    hash.addData(m_buildOptions.toUtf8());
+    for(unsigned int i = 0; i < m_context->GetNumberOfDevices(); ++i)
+    {
+        OCLDeviceInfo* device = m_context->GetDeviceInfo(i);
+        hash.addData(device->GetPlatformOwner()->GetPlatformVersion().toUtf8());
+        hash.addData(device->GetDeviceName().toUtf8());
+        hash.addData(device->GetDeviceVersion().toUtf8());
+        hash.addData(device->GetDriverVersion().toUtf8());
+    }
+    return QString(hash.result().toHex());
+}
+
+// Create the program from the binaries of every device in the cache file
+bool OCLProgram::LoadProgramBinaries(const QString& fileName)
+{
+    QFile file(fileName);
+    if(!file.open(QFile::ReadOnly))
+        return false;
+    QDataStream stream(&file);
+    quint32 magic;
+    QList<QByteArray> binaries;
+    stream >> magic >> binaries;
+    file.close();
+
+    uint numDevices = m_context->GetNumberOfDevices();
+    if(stream.status() != QDataStream::Ok || magic != BINARY_CACHE_MAGIC || (uint)binaries.size() != numDevices)
+        return false;
+
+    size_t* lengths = new size_t[numDevices];
+    const unsigned char** data = new const unsigned char*[numDevices];
+    cl_int* binaryStatus = new cl_int[numDevices];
+    for(uint i = 0; i < numDevices; ++i)
+    {
+        lengths[i] = binaries[i].size();
+        data[i] = (const unsigned char*)binaries[i].constData();
+    }
+    cl_int errNo;
+    m_oclInnerProgram = clCreateProgramWithBinary(m_context->GetInnerContext(), numDevices, m_context->GetDevicesID(), lengths, data, binaryStatus, &errNo);
+    for(uint i = 0; i < numDevices; ++i)
+        errNo |= binaryStatus[i];
+    delete[] binaryStatus;
+    delete[] data;
+    delete[] lengths;
+
+    // Binaries still need to be built, which is only a link step
+    if(errNo == CL_SUCCESS)
+    {
+        QByteArray options = m_buildOptions.toAscii();
+        errNo = clBuildProgram(m_oclInnerProgram, 0, 0, options.data(), 0, 0);
+    }
     if(errNo != CL_SUCCESS)
-        qDebug()<<"Error while compiling OpenCL program :\n"<<GetBuildInfos();
-    else
-        qDebug()<<"Compile successfully completed. No error found.";
-    return errNo == CL_SUCCESS;
+    {
+        qDebug()<<"OpenCL program cache"<<fileName<<"is out of date, compiling from source";
+        if(m_oclInnerProgram)
+            clReleaseProgram(m_oclInnerProgram);
+        m_oclInnerProgram = NULL;
+        return false;
+    }
+    return true;
+}
+
+// Write the binaries of every device of the built program in the cache file
+bool OCLProgram::SaveProgramBinaries(const QString& fileName)
+{
+    cl_uint numDevices;
+    clGetProgramInfo(m_oclInnerProgram, CL_PROGRAM_NUM_DEVICES, sizeof(numDevices), &numDevices, 0);
+    size_t* sizes = new size_t[numDevices];
+    unsigned char** data = new unsigned char*[numDevices];
+    QList<QByteArray> binaries;
+    clGetProgramInfo(m_oclInnerProgram, CL_PROGRAM_BINARY_SIZES, numDevices * sizeof(size_t), sizes, 0);
+    for(cl_uint i = 0; i < numDevices; ++i)
+    {
+        binaries.append(QByteArray((int)sizes[i], '\0'));
+        data[i] = (unsigned char*)binaries[i].data();
+    }
+    cl_int errNo = clGetProgramInfo(m_oclInnerProgram, CL_PROGRAM_BINARIES, numDevices * sizeof(unsigned char*), data, 0);
+    delete[] data;
+    delete[] sizes;
+    if(errNo != CL_SUCCESS || !QDir().mkpath(m_binaryCacheDirectory))
+        return false;
+
+    // Written aside then renamed, so a program running meanwhile never reads half a file
+    QString tempFileName = fileName + ".tmp";
+    QFile file(tempFileName);
+    if(!file.open(QFile::WriteOnly))
+        return false;
+    QDataStream stream(&file);
+    stream << BINARY_CACHE_MAGIC << binaries;
+    file.close();
+    QFile::remove(fileName);
+    return stream.status() == QDataStream::Ok && QFile::rename(tempFileName, fileName);
 }
 
 QString OCLProgram::GetBuildInfos()
@@ -186,30 +414,29 @@ QString OCLProgram::GetBuildInfo(OCLDeviceInfo* device)
     return returnString;
 }
 
-// Create a kernel function in this program
+// Create a kernel function in the current variant of this program
 OCLKernel* OCLProgram::CreateKernelFunction(QString kernelFunctionName)
 {
-    OCLKernel* kernel = m_kernels.value(kernelFunctionName, NULL);
+    OCLKernel* kernel = GetKernelByName(kernelFunctionName);
     if(!kernel)
     {
+        WaitForBuild();
         kernel = new OCLKernel(this, kernelFunctionName);
-        m_kernels.insert(kernelFunctionName, kernel);
+        m_kernels.insert(m_currentProgramKey + "/" + kernelFunctionName, kernel);
     }
     return kernel;
 }
 
-// Get a previously created kernel function by it's name
+// Get a previously created kernel function of the current variant by it's name
 OCLKernel* OCLProgram::GetKernelByName(QString kernelName) const
 {
-    return m_kernels.value(kernelName, NULL);
+    return m_kernels.value(m_currentProgramKey + "/" + kernelName, NULL);
 }
 
 // Execute the specified kernel function into the specified dimension with the specified worker
 bool OCLProgram::ExecuteKernel(OCLKernel* kernel, unsigned int workDimension, const size_t* globalWorkSize, const size_t* localWorkSize)
 {
-    int errNo = clEnqueueNDRangeKernel(m_commandQueue, kernel->GetInnerKernel(), workDimension, 0, globalWorkSize, localWorkSize, 0, 0, 0);
-    qDebug() << errNo;
-    return errNo == CL_SUCCESS;
+    return EnqueueKernel(kernel, workDimension, globalWorkSize, localWorkSize).IsValid();
 }
 
 bool OCLProgram::ExecuteKernel(QString kernelName, unsigned int workDimension, const size_t* globalWorkSize, const size_t* localWorkSize)
@@ -249,7 +476,7 @@ OCLBuffer* OCLProgram::GetBuffer(QString name)
 
 bool OCLProgram::ReadBuffer(OCLBuffer* buffer, void* dest)
 {
-    return clEnqueueReadBuffer(m_commandQueue, buffer->GetInnerBuffer(), CL_TRUE, 0, buffer->GetSize(), dest, 0, 0, 0) == CL_SUCCESS;
+    return EnqueueReadBuffer(buffer, dest).Wait();
 }
 
 bool OCLProgram::ReadBuffer(QString bufferName, void* dest)
@@ -257,14 +484,14 @@ bool OCLProgram::ReadBuffer(QString bufferName, void* dest)
     OCLBuffer* buffer = m_buffers.value(bufferName, NULL);
     if(buffer)
     {
-        return clEnqueueReadBuffer(m_commandQueue, buffer->GetInnerBuffer(), CL_TRUE, 0, buffer->GetSize(), dest, 0, 0, 0) == CL_SUCCESS;
+        return ReadBuffer(buffer, dest);
     }
     return false;
 }
 
 bool OCLProgram::WriteBuffer(OCLBuffer* buffer, void* source)
 {
-    return clEnqueueWriteBuffer(m_commandQueue, buffer->GetInnerBuffer(), CL_FALSE, 0, buffer->GetSize(), source, 0, 0, 0) == CL_SUCCESS;
+    return EnqueueWriteBuffer(buffer, source).IsValid();
 }
 
 bool OCLProgram::WriteBuffer(QString bufferName, void* source)
@@ -272,7 +499,148 @@ bool OCLProgram::WriteBuffer(QString bufferName, void* source)
     OCLBuffer* buffer = m_buffers.value(bufferName, NULL);
     if(buffer)
     {
-        return clEnqueueWriteBuffer(m_commandQueue, buffer->GetInnerBuffer(), CL_FALSE, 0, buffer->GetSize(), source, 0, 0, 0) == CL_SUCCESS;
+        return WriteBuffer(buffer, source);
     }
     return false;
 }
+
+// Create a command queue on a device (the first one by default), return its index. Queue 0 is created
+// with the program. An out-of-order queue runs commands as soon as the events they wait for are
+// complete; it is in order if the device does not support it.
+int OCLProgram::CreateCommandQueue(bool outOfOrder, OCLDeviceInfo* device)
+{
+    cl_device_id deviceID = device ? device->GetDeviceID() : m_context->GetDevicesID()[0];
+    cl_command_queue_properties properties = 0;
+    if(outOfOrder)
+    {
+        cl_command_queue_properties supported = 0;
+        clGetDeviceInfo(deviceID, CL_DEVICE_QUEUE_PROPERTIES, sizeof(supported), &supported, 0);
+        if(supported & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE)
+            properties |= CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE;
+        else
+            qDebug()<<"Out-of-order queues are not supported, using an in-order queue.";
+    }
+
+    cl_command_queue queue = CreateInnerCommandQueue(deviceID, properties);
+    if(!queue)
+        return -1;
+    m_commandQueues.append(queue);
+    m_queueDevices.append(deviceID);
+    m_queueProperties.append(properties);
+    return m_commandQueues.size() - 1;
+}
+
+cl_command_queue OCLProgram::CreateInnerCommandQueue(cl_device_id deviceID, cl_command_queue_properties properties)
+{
+    if(m_profiler)
+        properties |= CL_QUEUE_PROFILING_ENABLE;
+    cl_int errNo;
+    cl_command_queue queue = clCreateCommandQueue(m_context->GetInnerContext(), deviceID, properties, &errNo);
+    if(errNo != CL_SUCCESS)
+    {
+        qDebug()<<"Error on creating command queue :"<<errNo;
+        return NULL;
+    }
+    return queue;
+}
+
+// Record the timestamps of every command from now on (or stop). The queues are created again with
+// profiling enabled, so this is meant to be called before enqueuing commands.
+void OCLProgram::SetProfilingEnabled(bool enabled)
+{
+    if(enabled == (m_profiler != NULL))
+        return;
+    if(enabled)
+        m_profiler = new OCLProfiler();
+    else
+    {
+        delete m_profiler;
+        m_profiler = NULL;
+    }
+
+    for(int i = 0; i < m_commandQueues.size(); ++i)
+    {
+        clFinish(m_commandQueues[i]);
+        cl_command_queue queue = CreateInnerCommandQueue(m_queueDevices[i], m_queueProperties[i]);
+        if(queue)
+        {
+            clReleaseCommandQueue(m_commandQueues[i]);
+            m_commandQueues[i] = queue;
+        }
+    }
+}
+
+// Start sending the enqueued commands of a queue to its device
+bool OCLProgram::Flush(int queue)
+{
+    return clFlush(m_commandQueues[queue]) == CL_SUCCESS;
+}
+
+// Wait for all the commands of a queue
+bool OCLProgram::Finish(int queue)
+{
+    return clFinish(m_commandQueues[queue]) == CL_SUCCESS;
+}
+
+// Events of a wait list, as given to the enqueue functions (NULL when the list is empty)
+cl_event* OCLProgram::GetInnerEvents(const QList<OCLEvent>& waitList, cl_uint& count)
+{
+    count = 0;
+    if(waitList.isEmpty())
+        return NULL;
+    cl_event* events = new cl_event[waitList.size()];
+    for(int i = 0; i < waitList.size(); ++i)
+    {
+        if(waitList[i].IsValid())
+            events[count++] = waitList[i].GetInnerEvent();
+    }
+    return events;
+}
+
+// Enqueue the kernel after the commands of waitList, without waiting for it
+OCLEvent OCLProgram::EnqueueKernel(OCLKernel* kernel, unsigned int workDimension, const size_t* globalWorkSize, const size_t* localWorkSize, const QList<OCLEvent>& waitList, int queue)
+{
+    cl_uint waitCount;
+    cl_event* waitEvents = GetInnerEvents(waitList, waitCount);
+    cl_event event = NULL;
+    int errNo = clEnqueueNDRangeKernel(m_commandQueues[queue], kernel->GetInnerKernel(), workDimension, 0, globalWorkSize, localWorkSize, waitCount, waitCount ? waitEvents : NULL, &event);
+    delete[] waitEvents;
+    if(errNo != CL_SUCCESS)
+        qDebug()<<"Error on enqueuing kernel"<<kernel->GetKernelName()<<":"<<errNo;
+    OCLEvent kernelEvent(errNo == CL_SUCCESS ? event : NULL);
+    if(m_profiler)
+        m_profiler->Record(kernelEvent, OCLProfiler::KERNEL, kernel->GetKernelName(), 0, queue);
+    return kernelEvent;
+}
+
+// Enqueue the read of the buffer after the commands of waitList; dest must stay valid until the event is complete
+OCLEvent OCLProgram::EnqueueReadBuffer(OCLBuffer* buffer, void* dest, const QList<OCLEvent>& waitList, int queue)
+{
+    cl_uint waitCount;
+    cl_event* waitEvents = GetInnerEvents(waitList, waitCount);
+    cl_event event = NULL;
+    int errNo = clEnqueueReadBuffer(m_commandQueues[queue], buffer->GetInnerBuffer(), CL_FALSE, 0, buffer->GetSize(), dest, waitCount, waitCount ? waitEvents : NULL, &event);
+    delete[] waitEvents;
+    if(errNo != CL_SUCCESS)
+        qDebug()<<"Error on enqueuing buffer read :"<<errNo;
+    OCLEvent readEvent(errNo == CL_SUCCESS ? event : NULL);
+    if(m_profiler)
+        m_profiler->Record(readEvent, OCLProfiler::READ_BUFFER, m_buffers.key(buffer), buffer->GetSize(), queue);
+    return readEvent;
+}
+
+// Enqueue the write of the buffer after the commands of waitList; source must stay valid until the event is complete
+OCLEvent OCLProgram::EnqueueWriteBuffer(OCLBuffer* buffer, const void* source, const QList<OCLEvent>& waitList, int queue)
+{
+    cl_uint waitCount;
+    cl_event* waitEvents = GetInnerEvents(waitList, waitCount);
+    cl_event event = NULL;
+    int errNo = clEnqueueWriteBuffer(m_commandQueues[queue], buffer->GetInnerBuffer(), CL_FALSE, 0, buffer->GetSize(), source, waitCount, waitCount ? waitEvents : NULL, &event);
+    delete[] waitEvents;
+    if(errNo != CL_SUCCESS)
+        qDebug()<<"Error on enqueuing buffer write :"<<errNo;
+    OCLEvent writeEvent(errNo == CL_SUCCESS ? event : NULL);
+    if(m_profiler)
+        m_profiler->Record(writeEvent, OCLProfiler::WRITE_BUFFER, m_buffers.key(buffer), buffer->GetSize(), queue);
+    return writeEvent;
+}
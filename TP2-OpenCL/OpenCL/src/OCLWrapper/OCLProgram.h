@@ -3,13 +3,17 @@
 
 #include "OCLContext.h"
 #include "OCLBuffer.h"
+#include "OCLEvent.h"
 
 #include <CL/opencl.h>
 
 #include <QList>
 #include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
 
 class OCLKernel;
+class OCLProfiler;
 
 class OCLProgram
 {
@@ -19,6 +23,16 @@ public:
     ~OCLProgram();
 
     OCLContext* GetContext() const { return m_context; }
+
+    // Options given to the compiler, part of the binary cache key
+    void SetBuildOptions(const QString& options) { m_buildOptions = options; }
+    void AddBuildDefine(const QString& name, const QString& value);
+    void AddBuildDefine(const QString& name, unsigned long value);
+    QString GetBuildOptions() const { return m_buildOptions; }
+
+    // Directory of the compiled programs (empty to always compile from source)
+    void SetBinaryCacheDirectory(const QString& directory) { m_binaryCacheDirectory = directory; }
+    QString GetBinaryCacheDirectory() const { return m_binaryCacheDirectory; }
     
     bool AddProgramSourceFromSourceFile(QString fileName);
     bool AddProgramSourceFromSourceCode(const QString& sourceCode);
@@ -29,6 +43,13 @@ public:
     bool CreateProgramFromSourceFile(QString fileName);
     bool CreateProgramWithAddedSources();
 
+    // Start building the program without waiting for the compiler, so the host can be set up meanwhile.
+    // Every variant (code and build options) built is kept: starting one again only makes it current.
+    bool StartProgramFromSourceCode(const char** sourceCode, int sourceCount);
+    bool StartProgramFromSourceFile(QString fileName);
+    bool IsBuildFinished();
+    bool WaitForBuild();
+
     OCLBuffer* CreateBuffer(QString name, OCLBuffer::BufferAccess flags, int size);
     OCLBuffer* CreateBuffer(QString name, OCLBuffer::BufferAccess flags, int size, void* source);
     OCLBuffer* GetBuffer(QString name);
@@ -43,21 +64,54 @@ public:
     bool ExecuteKernel(OCLKernel* kernel, unsigned int workDimension, const size_t* globalWorkSize, const size_t* localWorkSize);
     bool ExecuteKernel(QString kernelName, unsigned int workDimension, const size_t* globalWorkSize, const size_t* localWorkSize);
 
+    // Asynchronous API: commands run once the commands of their wait list are complete and return
+    // their event. Queue 0 is the in-order queue of the synchronous functions above.
+    int CreateCommandQueue(bool outOfOrder = false, OCLDeviceInfo* device = NULL);
+    int GetCommandQueueCount() const { return m_commandQueues.size(); }
+    bool Flush(int queue = 0);
+    bool Finish(int queue = 0);
+    OCLEvent EnqueueKernel(OCLKernel* kernel, unsigned int workDimension, const size_t* globalWorkSize, const size_t* localWorkSize,
+                           const QList<OCLEvent>& waitList = QList<OCLEvent>(), int queue = 0);
+    OCLEvent EnqueueReadBuffer(OCLBuffer* buffer, void* dest, const QList<OCLEvent>& waitList = QList<OCLEvent>(), int queue = 0);
+    OCLEvent EnqueueWriteBuffer(OCLBuffer* buffer, const void* source, const QList<OCLEvent>& waitList = QList<OCLEvent>(), int queue = 0);
+
+    // Opt-in profiling of every kernel and buffer transfer
+    void SetProfilingEnabled(bool enabled);
+    OCLProfiler* GetProfiler() const { return m_profiler; }
+
     QString GetBuildInfos();
     QString GetBuildInfo(OCLDeviceInfo* device);
     
 private:
     cl_program GetInnerProgram() const { return m_oclInnerProgram; }
 
+    QString GetProgramKey(const char** sourceCode, int sourceCount) const;
+    bool LoadProgramBinaries(const QString& fileName);
+    bool SaveProgramBinaries(const QString& fileName);
+    static void CL_CALLBACK OnBuildFinished(cl_program program, void* userData);
+    cl_command_queue CreateInnerCommandQueue(cl_device_id deviceID, cl_command_queue_properties properties);
+    static cl_event* GetInnerEvents(const QList<OCLEvent>& waitList, cl_uint& count);
+
 	OCLProgram(const OCLProgram&);
 	OCLProgram& operator=(const OCLProgram&);
 
     OCLContext* m_context;
     cl_program m_oclInnerProgram;
-    cl_command_queue m_commandQueue;
+    QList<cl_command_queue> m_commandQueues;
+    QList<cl_device_id> m_queueDevices;
+    QList<cl_command_queue_properties> m_queueProperties;
+    QHash<QString, cl_program> m_programs;
+    QString m_currentProgramKey;
     QHash<QString, OCLKernel*> m_kernels;    
     QHash<QString, OCLBuffer*> m_buffers;
     QList<QString> m_programsCode;
+    QString m_buildOptions;
+    QString m_binaryCacheDirectory;
+    QString m_pendingBinaryCacheFile;
+    bool m_buildFinished;
+    QMutex m_buildMutex;
+    QWaitCondition m_buildFinishedCondition;
+    OCLProfiler* m_profiler;
 
     friend class OCLKernel;
 };
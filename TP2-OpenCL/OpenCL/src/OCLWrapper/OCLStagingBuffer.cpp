@@ -0,0 +1,30 @@
+#include "OCLStagingBuffer.h"
+
+OCLStagingBuffer::OCLStagingBuffer(int size, int slotCount)
+: m_size(size)
+{
+    for(int i = 0; i < slotCount; ++i)
+    {
+        m_slots.append(new char[size]);
+        m_events.append(OCLEvent());
+    }
+}
+
+OCLStagingBuffer::~OCLStagingBuffer()
+{
+    // Transfers in flight still write or read the slots
+    for(int i = 0; i < m_slots.size(); ++i)
+    {
+        if(m_events[i].IsValid())
+            m_events[i].Wait();
+        delete[] m_slots[i];
+    }
+}
+
+void* OCLStagingBuffer::WaitForSlot(int slot)
+{
+    if(m_events[slot].IsValid() && !m_events[slot].Wait())
+        return NULL;
+    m_events[slot] = OCLEvent();
+    return m_slots[slot];
+}
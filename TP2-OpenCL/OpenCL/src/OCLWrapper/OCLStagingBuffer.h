@@ -0,0 +1,40 @@
+#ifndef _OCL_STAGING_BUFFER_H_
+#define _OCL_STAGING_BUFFER_H_
+
+#include "OCLEvent.h"
+
+#include <QList>
+
+// Host memory of transfers, split in slots (two by default) used in turn: the host fills or drains
+// one slot while the transfer of the other one is in flight.
+class OCLStagingBuffer
+{
+public:
+    OCLStagingBuffer(int size, int slotCount = 2);
+    ~OCLStagingBuffer();
+
+    int GetSize() const { return m_size; }
+    int GetSlotCount() const { return m_slots.size(); }
+
+    // Memory of a slot, to give to an enqueued transfer
+    void* GetSlotData(int slot) const { return m_slots[slot]; }
+
+    // Last transfer using a slot
+    void SetSlotEvent(int slot, const OCLEvent& event) { m_events[slot] = event; }
+
+    // Whether the last transfer using a slot is done
+    bool IsSlotReady(int slot) const { return !m_events[slot].IsValid() || m_events[slot].IsComplete(); }
+
+    // Wait for the last transfer using a slot, return its memory (NULL if the transfer failed)
+    void* WaitForSlot(int slot);
+
+private:
+    OCLStagingBuffer(const OCLStagingBuffer&);
+    OCLStagingBuffer& operator=(const OCLStagingBuffer&);
+
+    int m_size;
+    QList<char*> m_slots;
+    QList<OCLEvent> m_events;
+};
+
+#endif //_OCL_STAGING_BUFFER_H_